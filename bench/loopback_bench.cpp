@@ -0,0 +1,130 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "core/utils.h"
+#include "net/server.h"
+#include "net/client.h"
+#include "net/packet.h"
+
+/*
+ * Drives a Server over loopback with in-process clients and reports
+ * the CPU the server tick spends per packet. Every client sends a
+ * burst of packets each frame; the server echoes each one back.
+ * Also serves as the training run for PGO builds (see README).
+ *
+ * Usage: loopback_bench [clients] [seconds] [packets per frame] [payload bytes]
+ */
+namespace {
+    constexpr uint16_t port = 18421;
+
+    uint64_t thread_cpu_time_us() {
+        timespec time;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+        return (uint64_t)time.tv_sec * 1000000 + time.tv_nsec / 1000;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    using namespace snow;
+
+    uint32_t client_count = (argc > 1) ? (uint32_t)strtoul(argv[1], nullptr, 10) : 16;
+    double seconds = (argc > 2) ? strtod(argv[2], nullptr) : 5.0;
+    uint32_t burst = (argc > 3) ? (uint32_t)strtoul(argv[3], nullptr, 10) : 8;
+    size_t payload = (argc > 4) ? strtoul(argv[4], nullptr, 10) : 64;
+
+    Server server(port, client_count);
+    server.tick_rate = 500;
+
+    // Every client comes from 127.0.0.1
+    server.admission.rate = (float)client_count;
+    server.admission.burst = (float)client_count;
+
+    std::atomic<bool> ready(false);
+    uint64_t received = 0;
+    uint64_t server_cpu_us = 0;
+
+    // The server belongs to this thread until it stops
+    std::thread server_thread([&]() {
+        server.init();
+        ready = true;
+
+        uint64_t cpu_start = thread_cpu_time_us();
+        server.start([&received](Server& server) {
+            Message* msg = server.read_packet();
+            while (msg != nullptr) {
+                server.send_packet(msg->packet, msg->event.peer, _CHANNEL_UNRELIABLE);
+                received++;
+                msg = server.read_packet();
+            }
+        });
+        server_cpu_us = thread_cpu_time_us() - cpu_start;
+    });
+
+    while (!ready) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    std::vector<std::unique_ptr<Client>> clients;
+    for (uint32_t i = 0; i < client_count; i++) {
+        std::unique_ptr<Client> client = std::make_unique<Client>();
+        if (!client->connect_to_server("127.0.0.1", port)) {
+            std::fprintf(stderr, "Client %u failed to connect\n", i);
+            server.stop();
+            server_thread.join();
+            return EXIT_FAILURE;
+        }
+        clients.push_back(std::move(client));
+    }
+
+    Packet packet;
+    packet.size = payload;
+    packet.data = std::make_unique<uint8_t[]>(payload);
+    memset(packet.data.get(), 0xA5, payload);
+
+    uint64_t sent = 0;
+    uint64_t echoed = 0;
+    uint64_t start = get_local_timestamp();
+    uint64_t end = start + (uint64_t)(seconds * 1000.0);
+
+    while (get_local_timestamp() < end) {
+        for (std::unique_ptr<Client>& client : clients) {
+            packet.uuid = client->get_uuid();
+            for (uint32_t i = 0; i < burst; i++) {
+                client->send_packet(packet, _CHANNEL_UNRELIABLE);
+            }
+            sent += burst;
+
+            client->poll_events([&echoed](ENetEvent&) {
+                echoed++;
+            });
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+
+    double elapsed = (double)(get_local_timestamp() - start) / 1000.0;
+    server.stop();
+    server_thread.join();
+
+    std::printf("%u clients, %u x %zu byte packets per frame, %.1f s\n", client_count, burst, payload, elapsed);
+    std::printf("sent %llu, server received %llu (%.0f/s), echoed %llu\n",
+        (unsigned long long)sent,
+        (unsigned long long)received,
+        (double)received / elapsed,
+        (unsigned long long)echoed
+    );
+    if (received > 0) {
+        std::printf("server CPU %.1f ms, %.3f us per packet\n",
+            (double)server_cpu_us / 1000.0,
+            (double)server_cpu_us / (double)received
+        );
+    }
+
+    return EXIT_SUCCESS;
+}
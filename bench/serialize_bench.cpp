@@ -0,0 +1,124 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "core/utils.h"
+#include "core/serialize.h"
+
+/*
+ * Compares the per-value serializers in core/utils.h
+ * against the bulk kernels in core/serialize.h.
+ *
+ * Usage: serialize_bench [entities] [iterations]
+ */
+namespace {
+    volatile uint64_t sink = 0;
+
+    template <typename F>
+    double time_ms(uint32_t iterations, F function) {
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < iterations; i++) {
+            function();
+        }
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::milli>(end - start).count();
+    }
+
+    void report(const char* name, double ms, size_t bytes, uint32_t iterations) {
+        double mb_per_sec = ((double)bytes * iterations / (1024.0 * 1024.0)) / (ms / 1000.0);
+        std::printf("%-28s %10.3f ms %10.1f MB/s\n", name, ms, mb_per_sec);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    using namespace snow;
+
+    size_t entities = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 500;
+    uint32_t iterations = (argc > 2) ? (uint32_t)strtoul(argv[2], nullptr, 10) : 20000;
+
+    // xyz position per entity
+    size_t float_count = entities * 3;
+    std::vector<float> floats(float_count);
+    std::vector<uint64_t> ids(entities);
+    for (size_t i = 0; i < float_count; i++) {
+        floats[i] = (float)i * 0.25f;
+    }
+    for (size_t i = 0; i < entities; i++) {
+        ids[i] = i * 0x9E3779B97F4A7C15ULL;
+    }
+
+    std::vector<uint8_t> buffer(float_count * sizeof(float) + entities * sizeof(uint64_t));
+    std::vector<float> floats_out(float_count);
+    std::vector<uint64_t> ids_out(entities);
+
+    std::printf("kernel: %s, entities: %zu, iterations: %u\n",
+        serialize_kernel_name(), entities, iterations);
+
+    size_t float_bytes = float_count * sizeof(float);
+    size_t id_bytes = entities * sizeof(uint64_t);
+
+    double ms = time_ms(iterations, [&]() {
+        for (size_t i = 0; i < float_count; i++) {
+            serialize_float(buffer.data() + i * 4, floats[i]);
+        }
+        sink += buffer[float_bytes - 1];
+    });
+    report("serialize_float (scalar)", ms, float_bytes, iterations);
+
+    ms = time_ms(iterations, [&]() {
+        serialize_floats(buffer.data(), floats.data(), float_count);
+        sink += buffer[float_bytes - 1];
+    });
+    report("serialize_floats (bulk)", ms, float_bytes, iterations);
+
+    ms = time_ms(iterations, [&]() {
+        for (size_t i = 0; i < float_count; i++) {
+            floats_out[i] = deserialize_float(buffer.data() + i * 4);
+        }
+        sink += (uint64_t)floats_out[float_count - 1];
+    });
+    report("deserialize_float (scalar)", ms, float_bytes, iterations);
+
+    ms = time_ms(iterations, [&]() {
+        deserialize_floats(buffer.data(), floats_out.data(), float_count);
+        sink += (uint64_t)floats_out[float_count - 1];
+    });
+    report("deserialize_floats (bulk)", ms, float_bytes, iterations);
+
+    ms = time_ms(iterations, [&]() {
+        for (size_t i = 0; i < entities; i++) {
+            serialize_uint64_t(buffer.data() + i * 8, ids[i]);
+        }
+        sink += buffer[id_bytes - 1];
+    });
+    report("serialize_uint64_t (scalar)", ms, id_bytes, iterations);
+
+    ms = time_ms(iterations, [&]() {
+        serialize_u64s(buffer.data(), ids.data(), entities);
+        sink += buffer[id_bytes - 1];
+    });
+    report("serialize_u64s (bulk)", ms, id_bytes, iterations);
+
+    ms = time_ms(iterations, [&]() {
+        for (size_t i = 0; i < entities; i++) {
+            ids_out[i] = deserialize_uint64_t(buffer.data() + i * 8);
+        }
+        sink += ids_out[entities - 1];
+    });
+    report("deserialize_uint64_t (scalar)", ms, id_bytes, iterations);
+
+    ms = time_ms(iterations, [&]() {
+        deserialize_u64s(buffer.data(), ids_out.data(), entities);
+        sink += ids_out[entities - 1];
+    });
+    report("deserialize_u64s (bulk)", ms, id_bytes, iterations);
+
+    ms = time_ms(iterations, [&]() {
+        serialize_halfs(buffer.data(), floats.data(), float_count);
+        sink += buffer[float_count * 2 - 1];
+    });
+    report("serialize_halfs (quantized)", ms, float_count * 2, iterations);
+
+    return 0;
+}
@@ -0,0 +1,74 @@
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "enet/enet.h"
+
+#include "net/packet.h"
+
+/*
+ * Fuzz target for the packet codec: Packet::parse, Packet::deserialize
+ * and Packet(ENetEvent*) all see raw network input. They must agree
+ * with each other, never point outside the input, and anything that
+ * parses must survive a serialize/parse round trip.
+ */
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    using namespace snow;
+
+    PacketView view;
+    bool parsed = Packet::parse(data, size, view);
+
+    Packet packet;
+    if (packet.deserialize(data, size) != parsed) {
+        abort();
+    }
+
+    // The event constructor only ever reads the buffer
+    ENetPacket enet_packet = {};
+    enet_packet.data = (enet_uint8*)data;
+    enet_packet.dataLength = size;
+
+    ENetEvent event = {};
+    event.type = ENET_EVENT_TYPE_RECEIVE;
+    event.packet = &enet_packet;
+    Packet from_event(&event);
+
+    if (!parsed) {
+        if (from_event.size != 0 || from_event.data != nullptr) {
+            abort();
+        }
+        return 0;
+    }
+
+    if (view.size > 0 && (view.data < data || view.data + view.size != data + size)) {
+        abort();
+    }
+    if (from_event.uuid != view.uuid || from_event.size != view.size) {
+        abort();
+    }
+
+    Packet copy(view);
+    std::vector<uint8_t> buffer(copy.get_size());
+    PacketWriter writer(buffer.data(), buffer.size());
+    if (!copy.serialize(writer) || writer.size() != buffer.size()) {
+        abort();
+    }
+
+    // Re-encoding is canonical, so never longer than the input
+    if (buffer.size() > size) {
+        abort();
+    }
+
+    PacketView again;
+    if (!Packet::parse(buffer.data(), buffer.size(), again)) {
+        abort();
+    }
+    if (again.uuid != view.uuid || again.size != view.size) {
+        abort();
+    }
+    if (view.size > 0 && memcmp(again.data, view.data, view.size) != 0) {
+        abort();
+    }
+
+    return 0;
+}
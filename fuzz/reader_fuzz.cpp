@@ -0,0 +1,123 @@
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "core/utils.h"
+#include "core/serialize.h"
+#include "net/packet_io.h"
+
+/*
+ * Fuzz target for the value decoders in core/utils.h, core/serialize.h
+ * and PacketReader. The bulk kernels must match the per-value decoders
+ * at every alignment, and a PacketReader driven by the input itself
+ * must never read past the end or recover from a failed read.
+ */
+namespace {
+    void check_bulk(const uint8_t* data, size_t size) {
+        using namespace snow;
+
+        size_t count = size / sizeof(uint64_t);
+        std::vector<uint64_t> u64s(count);
+        deserialize_u64s(data, u64s.data(), count);
+        for (size_t i = 0; i < count; i++) {
+            if (u64s[i] != deserialize_uint64_t(data + i * sizeof(uint64_t))) {
+                abort();
+            }
+        }
+
+        count = size / sizeof(uint32_t);
+        std::vector<float> floats(count);
+        std::vector<uint32_t> u32s(count);
+        deserialize_floats(data, floats.data(), count);
+        deserialize_u32s(data, u32s.data(), count);
+        for (size_t i = 0; i < count; i++) {
+            // Compare bits; NaN payloads must survive too
+            float expected = deserialize_float(data + i * sizeof(uint32_t));
+            if (memcmp(&floats[i], &expected, sizeof(float)) != 0) {
+                abort();
+            }
+            if (memcmp(&u32s[i], &expected, sizeof(uint32_t)) != 0) {
+                abort();
+            }
+        }
+
+        count = size / sizeof(uint16_t);
+        std::vector<float> halfs(count);
+        deserialize_halfs(data, halfs.data(), count);
+        for (size_t i = 0; i < count; i++) {
+            uint16_t half = (uint16_t)((data[i * 2] << 8) | data[i * 2 + 1]);
+            float expected = half_to_float(half);
+            if (memcmp(&halfs[i], &expected, sizeof(float)) != 0) {
+                abort();
+            }
+        }
+    }
+
+    void check_reader(const uint8_t* data, size_t size) {
+        using namespace snow;
+
+        PacketReader reader(data, size);
+        uint8_t scratch[256];
+
+        uint8_t op = 0;
+        while (reader.read_u8(op)) {
+            size_t before = reader.remaining();
+            bool ok = false;
+
+            switch (op % 9)
+            {
+                case 0: { uint8_t value; ok = reader.read_u8(value); break; }
+                case 1: { uint16_t value; ok = reader.read_u16(value); break; }
+                case 2: { uint32_t value; ok = reader.read_u32(value); break; }
+                case 3: { uint64_t value; ok = reader.read_u64(value); break; }
+                case 4: { float value; ok = reader.read_float(value); break; }
+                case 5:
+                {
+                    uint64_t value;
+                    ok = reader.read_varint(value);
+
+                    // Only the minimal encoding is accepted
+                    if (ok && before - reader.remaining() != varint_size(value)) {
+                        abort();
+                    }
+                    break;
+                }
+                case 6: { Uuid uuid; ok = reader.read_uuid(uuid); break; }
+                case 7: { ok = reader.read_bytes(scratch, op >> 3); break; }
+                case 8:
+                {
+                    const uint8_t* view = nullptr;
+                    ok = reader.read_view(view, op);
+                    if (ok && (view < data || view + op > data + size)) {
+                        abort();
+                    }
+                    break;
+                }
+            }
+
+            if (reader.remaining() > before || ok != reader.ok()) {
+                abort();
+            }
+            if (!ok) {
+                break;
+            }
+        }
+
+        // Failure is sticky
+        if (!reader.ok() && (reader.read_u8(op) || reader.ok())) {
+            abort();
+        }
+    }
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    check_bulk(data, size);
+
+    // Unaligned starts take the kernels' tail paths
+    if (size > 1) {
+        check_bulk(data + 1, size - 1);
+    }
+
+    check_reader(data, size);
+    return 0;
+}
@@ -0,0 +1,87 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+/*
+ * Driver for the fuzz targets when not linking libFuzzer. Replays
+ * every file named on the command line (directories are walked one
+ * level deep), so the regression corpus runs under ctest with any
+ * compiler.
+ *
+ * Usage: <target> [--throughput iterations] <file|dir>...
+ * Throughput mode runs every input iterations times and reports the
+ * input MB/s the target gets through. Other options starting with '-'
+ * belong to libFuzzer and are ignored.
+ */
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+namespace {
+    bool read_file(const std::filesystem::path& path, std::vector<std::vector<uint8_t>>& inputs) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            std::fprintf(stderr, "Failed to open %s\n", path.string().c_str());
+            return false;
+        }
+
+        inputs.emplace_back(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        return true;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    uint32_t iterations = 0;
+    std::vector<std::vector<uint8_t>> inputs;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--throughput") == 0 && i + 1 < argc) {
+            iterations = (uint32_t)strtoul(argv[++i], nullptr, 10);
+            continue;
+        }
+        if (argv[i][0] == '-') {
+            continue;
+        }
+
+        std::filesystem::path path(argv[i]);
+        if (std::filesystem::is_directory(path)) {
+            for (const auto& entry : std::filesystem::directory_iterator(path)) {
+                if (entry.is_regular_file() && !read_file(entry.path(), inputs)) {
+                    return EXIT_FAILURE;
+                }
+            }
+        }
+        else if (!read_file(path, inputs)) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    size_t bytes = 0;
+    for (const std::vector<uint8_t>& input : inputs) {
+        LLVMFuzzerTestOneInput(input.data(), input.size());
+        bytes += input.size();
+    }
+    std::printf("Ran %zu inputs (%zu bytes)\n", inputs.size(), bytes);
+
+    if (iterations == 0 || bytes == 0) {
+        return EXIT_SUCCESS;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < iterations; i++) {
+        for (const std::vector<uint8_t>& input : inputs) {
+            LLVMFuzzerTestOneInput(input.data(), input.size());
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    double mb_per_sec = ((double)bytes * iterations / (1024.0 * 1024.0)) / seconds;
+    std::printf("%u iterations in %.3f s: %.1f MB/s\n", iterations, seconds, mb_per_sec);
+
+    return EXIT_SUCCESS;
+}
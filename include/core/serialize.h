@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace snow {
+    // Bulk conversion to and from network byte order.
+    // Buffers need not be aligned.
+    void serialize_floats(uint8_t* buffer, const float* values, size_t count);
+    void deserialize_floats(const uint8_t* buffer, float* values, size_t count);
+    void serialize_u32s(uint8_t* buffer, const uint32_t* values, size_t count);
+    void deserialize_u32s(const uint8_t* buffer, uint32_t* values, size_t count);
+    void serialize_u64s(uint8_t* buffer, const uint64_t* values, size_t count);
+    void deserialize_u64s(const uint8_t* buffer, uint64_t* values, size_t count);
+
+    // Fixed-point quantization over [min, max] using the given bit count
+    uint32_t quantize_float(float value, float min, float max, uint32_t bits);
+    float dequantize_float(uint32_t value, float min, float max, uint32_t bits);
+
+    // IEEE 754 half precision
+    uint16_t float_to_half(float value);
+    float half_to_float(uint16_t value);
+    void serialize_halfs(uint8_t* buffer, const float* values, size_t count);
+    void deserialize_halfs(const uint8_t* buffer, float* values, size_t count);
+
+    // Smallest-three quaternion compression (x, y, z, w) into 32 bits
+    uint32_t quantize_quaternion(const float quaternion[4]);
+    void dequantize_quaternion(uint32_t packed, float quaternion[4]);
+
+    // Name of the byte swap kernel selected for this CPU
+    const char* serialize_kernel_name();
+}
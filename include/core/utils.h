@@ -5,10 +5,9 @@
 #include <cstdarg>
 #include <cstdio>
 
-namespace snow {
-    // 36 characters plus null terminator
-    constexpr uint32_t _UUID_SIZE = 37;
+#include "core/uuid.h"
 
+namespace snow {
     void serialize_float(uint8_t* buffer, float value);
     float deserialize_float(const uint8_t* buffer);
     void serialize_uint64_t(uint8_t* buffer, uint64_t value);
@@ -18,7 +17,7 @@ namespace snow {
     uint64_t ntohll(uint64_t value);
 
     uint64_t get_local_timestamp();
-    std::string generate_uuid();
+    uint64_t get_monotonic_time_us();
 
     inline void debug_log_impl(
         const char* level,
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <string>
+#include <cstring>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace snow {
+    // Binary size on the wire
+    constexpr uint32_t _UUID_SIZE = 16;
+
+    // 36 characters plus null terminator
+    constexpr uint32_t _UUID_STRING_SIZE = 37;
+
+    /*
+     * 128-bit identifier stored as raw bytes.
+     * Trivially copyable; the all-zero value is the nil UUID.
+     */
+    struct Uuid {
+        uint8_t bytes[_UUID_SIZE];
+
+        constexpr bool is_nil() const {
+            for (uint32_t i = 0; i < _UUID_SIZE; i++) {
+                if (this->bytes[i] != 0) return false;
+            }
+            return true;
+        }
+
+        constexpr bool operator==(const Uuid& other) const {
+            for (uint32_t i = 0; i < _UUID_SIZE; i++) {
+                if (this->bytes[i] != other.bytes[i]) return false;
+            }
+            return true;
+        }
+
+        constexpr bool operator!=(const Uuid& other) const {
+            return !(*this == other);
+        }
+
+        /*
+         * Writes the canonical 8-4-4-4-12 form into buffer.
+         * Buffer must hold at least _UUID_STRING_SIZE characters.
+         */
+        constexpr void format(char* buffer) const {
+            const char* digits = "0123456789abcdef";
+            uint32_t offset = 0;
+            for (uint32_t i = 0; i < _UUID_SIZE; i++) {
+                if (i == 4 || i == 6 || i == 8 || i == 10) {
+                    buffer[offset++] = '-';
+                }
+                buffer[offset++] = digits[this->bytes[i] >> 4];
+                buffer[offset++] = digits[this->bytes[i] & 0x0F];
+            }
+            buffer[offset] = '\0';
+        }
+
+        /*
+         * Parses the canonical 8-4-4-4-12 form.
+         * Returns false and leaves out untouched on malformed input.
+         */
+        static constexpr bool parse(const char* text, Uuid& out) {
+            Uuid result = {};
+            uint32_t offset = 0;
+            for (uint32_t i = 0; i < _UUID_SIZE; i++) {
+                if (i == 4 || i == 6 || i == 8 || i == 10) {
+                    if (text[offset++] != '-') return false;
+                }
+
+                int high = hex_value(text[offset++]);
+                if (high < 0) return false;
+                int low = hex_value(text[offset++]);
+                if (low < 0) return false;
+
+                result.bytes[i] = (uint8_t)((high << 4) | low);
+            }
+            if (text[offset] != '\0') return false;
+
+            out = result;
+            return true;
+        }
+
+        std::string to_string() const {
+            char buffer[_UUID_STRING_SIZE] = {};
+            this->format(buffer);
+            return std::string(buffer);
+        }
+
+        private:
+            static constexpr int hex_value(char c) {
+                if (c >= '0' && c <= '9') return c - '0';
+                if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+                if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+                return -1;
+            }
+    };
+
+    /*
+     * UUIDs are already random, so folding the two
+     * halves together is enough for hash tables.
+     */
+    struct UuidHash {
+        size_t operator()(const Uuid& uuid) const noexcept {
+            uint64_t high;
+            uint64_t low;
+            memcpy(&high, uuid.bytes, sizeof(uint64_t));
+            memcpy(&low, uuid.bytes + sizeof(uint64_t), sizeof(uint64_t));
+            return (size_t)(high ^ (low * 0x9E3779B97F4A7C15ULL));
+        }
+    };
+
+    Uuid generate_uuid();
+
+    // Unpredictable bytes for secrets and keys, straight from the OS
+    void fill_secure_random(uint8_t* data, size_t size);
+}
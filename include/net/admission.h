@@ -0,0 +1,55 @@
+#pragma once
+
+#include <unordered_map>
+#include <stdint.h>
+
+#include "enet/enet.h"
+
+namespace snow {
+    typedef struct {
+        float rate;                     // Connection attempts per second per IP
+        float burst;                    // Attempts allowed back to back per IP
+        uint32_t max_pending;           // Resumes waiting for their UUID at once
+        uint32_t handshake_timeout;     // Cookie lifetime and time to finish a resume (ms)
+    } AdmissionConfig;
+
+    enum class AdmissionResult : uint8_t {
+        Accept,
+        RateLimited,
+        Busy,
+    };
+
+    /*
+     * First stage of accepting a connection, run on the raw CONNECT
+     * datagram before ENet allocates a peer for it. Issues stateless
+     * cookies: a cookie is a keyed hash of the source address, connect
+     * mode and a coarse time epoch, so checking one needs nothing
+     * stored per client. Connects that come back with a valid cookie
+     * are then charged to a token bucket per source IP; spoofed
+     * addresses never get that far. Cookies travel in the ENet
+     * connect data; see control.h.
+     */
+    class Admission {
+        public:
+            Admission();
+
+            static AdmissionConfig defaults();
+
+            AdmissionResult admit(const AdmissionConfig& config, const ENetAddress& address, size_t pending, uint64_t now);
+            uint32_t make_cookie(const AdmissionConfig& config, const ENetAddress& address, uint32_t mode, uint64_t now) const;
+            bool check_cookie(const AdmissionConfig& config, const ENetAddress& address, uint32_t cookie, uint64_t now) const;
+
+        private:
+            typedef struct {
+                float tokens;
+                uint64_t updated;   // ms
+            } TokenBucket;
+
+            uint64_t m_key[2];
+            std::unordered_map<uint32_t, TokenBucket> m_buckets;
+            uint64_t m_last_prune;
+
+            uint32_t cookie(const ENetAddress& address, uint32_t mode, uint64_t epoch) const;
+            void prune(const AdmissionConfig& config, uint64_t now);
+    };
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace snow {
+    // Returned by add_channel() when the table is full
+    constexpr uint8_t _CHANNEL_INVALID = UINT8_MAX;
+
+    // ENet channel carrying Snow's control messages. User channel
+    // N travels on ENet channel N + 1, so this never moves.
+    constexpr uint8_t _CHANNEL_CONTROL = 0;
+
+    // Stamp the server puts in front of packets on snapshot channels:
+    // u64 tick, u64 tick start (server get_monotonic_time_us())
+    constexpr size_t _SNAPSHOT_STAMP_SIZE = 16;
+
+    enum class DeliveryMode : uint8_t {
+        ReliableOrdered,        // Resent until acknowledged, delivered in order
+        UnreliableSequenced,    // May be lost, late packets are discarded
+        UnreliableUnsequenced,  // May be lost or arrive in any order
+        LatestOnly,             // Unreliable, only the newest queued packet is sent
+    };
+
+    enum class DropPolicy : uint8_t {
+        DropNewest,     // Reject packets once the queue is full
+        DropOldest,     // Make room by discarding the oldest queued packet
+    };
+
+    typedef struct {
+        DeliveryMode mode;
+        uint32_t queue_limit;   // Max packets queued per tick, 0 for unlimited
+        DropPolicy drop_policy;
+        bool snapshots;         // Server stamps packets with its tick, clients
+                                // buffer them for interpolation (SnapshotBuffer)
+    } ChannelConfig;
+
+    typedef struct {
+        uint64_t packets_sent;
+        uint64_t bytes_sent;
+        uint64_t packets_received;
+        uint64_t bytes_received;
+        uint64_t packets_dropped;
+        uint64_t latency_total;     // Time spent queued before sending (ms)
+        uint64_t latency_max;
+        uint64_t latency_samples;
+    } ChannelStats;
+
+    class ChannelTable {
+        public:
+            ChannelTable();
+            static ChannelTable defaults();
+
+            uint8_t add_channel(
+                DeliveryMode mode,
+                uint32_t queue_limit = 0,
+                DropPolicy drop_policy = DropPolicy::DropOldest
+            );
+            void enable_snapshots(uint8_t channel);
+            size_t size() const;
+            size_t enet_channel_count() const;
+            uint8_t control_channel() const;
+            uint8_t enet_channel(uint8_t channel) const;
+            uint8_t user_channel(uint8_t enet_channel) const;
+            const ChannelConfig& config(uint8_t channel) const;
+            const ChannelStats& stats(uint8_t channel) const;
+            uint32_t packet_flags(uint8_t channel) const;
+            double average_latency(uint8_t channel) const;
+            void reset_stats();
+
+            void record_send(uint8_t channel, size_t bytes, uint64_t latency);
+            void record_receive(uint8_t channel, size_t bytes);
+            void record_drop(uint8_t channel);
+
+        private:
+            std::vector<ChannelConfig> m_configs;
+            std::vector<ChannelStats> m_stats;
+    };
+}
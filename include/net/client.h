@@ -1,25 +1,82 @@
 #pragma once
 
 #include <functional>
+#include <string>
+#include <unordered_map>
 
 #include "enet/enet.h"
 
 #include "core/utils.h"
 #include "net/packet.h"
+#include "net/channel.h"
+#include "net/control.h"
+#include "net/time_sync.h"
+#include "net/interpolation.h"
 
 namespace snow {
+    enum class ConnectState : uint8_t {
+        Disconnected,
+        Connecting,         // Getting a cookie, waiting for ENet to connect
+        Handshaking,        // Connected, waiting for a UUID
+        Connected,
+    };
+
     class Client {
         public:
+            ChannelTable channels;  // Must be set before connect_to_server()
+
             Client();
             ~Client();
             bool connect_to_server(const char* ip, uint16_t port);
+            void disconnect(uint32_t timeout);
+            bool is_connected() const;
+            bool is_connecting() const;
             void poll_events(std::function<void(ENetEvent&)> user_callback);
+            void send_packet(const Packet& packet, uint8_t channel);
             void send_packet(const Packet& packet, bool reliable, uint8_t channel);
-            const std::string& get_uuid() const;
+            const Uuid& get_uuid() const;
+
+            bool is_time_synchronized() const;
+            uint64_t server_time_now() const;
+            double estimated_server_tick() const;
+            uint64_t get_rtt() const;
+
+            SnapshotBuffer* get_snapshots(uint8_t channel);
+            bool sample_snapshots(uint8_t channel, SnapshotSample& out);
 
         private:
             ENetHost* m_connection;
             ENetPeer* m_server;
-            std::string m_uuid;
+            Uuid m_uuid;
+            ResumeSecret m_resume_secret;   // Needed to get m_uuid back after a handoff
+            bool m_enet_acquired;
+            ConnectState m_state;
+            uint64_t m_connect_deadline;    // get_monotonic_time_us()
+
+            // Latest answer from the server's admission stage
+            AdmissionReply m_admission_reply;
+            uint32_t m_admission_value;
+
+            // Kept for reconnecting after a server handoff
+            std::string m_server_ip;
+            uint16_t m_server_port;
+            uint32_t m_connect_mode;
+
+            TimeSync m_time_sync;
+            uint64_t m_next_time_sync;     // get_monotonic_time_us()
+
+            // One buffer per snapshot channel
+            std::unordered_map<uint8_t, SnapshotBuffer> m_snapshots;
+
+            static int intercept(ENetHost* host, ENetEvent* event);
+            bool begin_connect(uint32_t mode);
+            void handle_connect_event(ENetEvent& event);
+            void update_connect();
+            void update_time_sync();
+            void handle_control_message(ENetEvent& event, uint64_t received_at);
+            void reset_snapshots();
+            void buffer_snapshot(ENetEvent& event, uint8_t channel);
+
+            void _send_packet_immediate(const Packet& packet, uint32_t flags, uint8_t channel);
     };
 }
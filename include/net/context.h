@@ -0,0 +1,70 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "enet/enet.h"
+
+#include "net/server.h"
+
+namespace snow {
+    /*
+     * Owns ENet's global state and ticks any number of Servers
+     * (one per match) on a shared pool of worker threads.
+     *
+     * Thread safety contract:
+     *  - ENet is initialized by the first acquire_enet() and torn
+     *    down by the last release_enet(). Server, Client and Context
+     *    hold a reference each, so they may be created and destroyed
+     *    on any thread in any order.
+     *  - A Server is confined to one thread at a time. Once added to
+     *    a Context, only the worker currently ticking it touches it:
+     *    call its methods from inside its callbacks, never from
+     *    another thread. stop() is the one exception and may be
+     *    called from anywhere. remove_server() hands it back to the
+     *    caller, and must happen before the Server is destroyed.
+     *  - Different Servers share nothing and tick concurrently.
+     *    A Server's callbacks must not touch another Server.
+     *  - Context methods themselves are safe to call from any thread
+     *    except a worker (remove_server() from a callback deadlocks).
+     *  - A Client is not shared with the pool and follows the same
+     *    one-thread-at-a-time rule on its own.
+     */
+    class Context {
+        public:
+            Context(size_t thread_count = 0);  // 0 = one per core
+            ~Context();
+
+            void add_server(
+                Server& server,
+                std::function<void(Server&)> user_loop,
+                std::function<bool(Server&, ENetEvent&)> connect_callback = nullptr,
+                std::function<void(Server&, ENetEvent&)> disconnect_callback = nullptr
+            );
+            void remove_server(Server& server);
+            size_t server_count();
+            void shutdown();
+
+            static bool acquire_enet();
+            static void release_enet();
+            static size_t enet_reference_count();
+
+        private:
+            typedef struct {
+                Server* server;
+                uint64_t next_tick;     // ms
+                bool busy;              // Being ticked by a worker
+            } ScheduledServer;
+
+            std::mutex m_mutex;
+            std::condition_variable m_wakeup;
+            std::vector<ScheduledServer> m_servers;
+            std::vector<std::thread> m_workers;
+            bool m_shutdown;
+
+            void worker();
+    };
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "core/uuid.h"
+
+namespace snow {
+    /*
+     * Message types on the control channel.
+     * Every control message starts with one of these as a u8.
+     */
+    enum class ControlType : uint8_t {
+        TimeSyncRequest = 1,    // u64 client send time
+        TimeSyncResponse = 2,   // u64 client send time, u64 server receive time,
+                                // u64 server send time, u64 tick, u64 tick start, u16 tick rate
+        Resume = 3,             // UUID to reclaim after a handoff and its resume
+                                // secret, sent once connected with _CONNECT_RESUME
+    };
+
+    /*
+     * Random token sent to each client as the payload of its UUID
+     * packet. A client only gets its UUID back after a handoff if it
+     * can repeat the secret, since the UUID itself travels in the
+     * clear on every packet. Same 16 bytes as a UUID, but drawn from
+     * fill_secure_random().
+     */
+    typedef Uuid ResumeSecret;
+
+    /*
+     * ENet connect data. The low bit is the connect mode; the rest
+     * holds the admission cookie, zero until the server hands one out.
+     */
+    constexpr uint32_t _CONNECT_NEW = 0;
+    constexpr uint32_t _CONNECT_RESUME = 1;     // Client will send Resume with its old UUID
+    constexpr uint32_t _CONNECT_MODE_MASK = 1;
+
+    /*
+     * Raw datagrams the server answers CONNECT datagrams with before
+     * any peer exists, never larger than the CONNECT itself:
+     *   u16 _ADMISSION_MARKER, u8 AdmissionReply,
+     *   u32 connect ID being answered, u32 cookie or disconnect reason
+     * The marker is a peer id no ENet header to a client can carry.
+     */
+    enum class AdmissionReply : uint8_t {
+        None = 0,
+        Cookie = 1,             // Connect again with this as the connect data
+        Rejected = 2,           // Give up, with a _DISCONNECT_REASON_*
+    };
+    constexpr uint16_t _ADMISSION_MARKER = 0xFFFF;
+    constexpr size_t _ADMISSION_REPLY_SIZE = 11;
+
+    // ENet disconnect data
+    constexpr uint32_t _DISCONNECT_REASON_NONE = 0;
+    constexpr uint32_t _DISCONNECT_REASON_SHUTDOWN = 1;
+    constexpr uint32_t _DISCONNECT_REASON_HANDOFF = 2;  // Reconnect to the same address
+    constexpr uint32_t _DISCONNECT_REASON_REJECTED = 3;
+    constexpr uint32_t _DISCONNECT_REASON_RATE_LIMITED = 4;
+    constexpr uint32_t _DISCONNECT_REASON_BUSY = 5;
+    constexpr uint32_t _DISCONNECT_REASON_HANDSHAKE_TIMEOUT = 6;
+    constexpr uint32_t _DISCONNECT_REASON_BACKPRESSURE = 7;    // Fell too far behind on sends
+
+    // How long a handed-off client may take to reclaim its UUID (ms)
+    constexpr uint32_t _HANDOFF_RESUME_WINDOW = 30000;
+
+    // Largest control message, in bytes
+    constexpr uint32_t _CONTROL_MAX_SIZE = 64;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+#include "enet/enet.h"
+
+#include "core/uuid.h"
+#include "net/control.h"
+
+namespace snow {
+    // Largest handoff message accepted, in bytes
+    constexpr uint32_t _HANDOFF_MAX_SIZE = 16 * 1024 * 1024;
+
+    typedef struct {
+        Uuid uuid;
+        ResumeSecret secret;
+        ENetAddress address;
+    } HandoffClient;
+
+    /*
+     * Everything one server process hands to its replacement:
+     * the bound UDP socket, the client table and an opaque
+     * blob of game state.
+     */
+    typedef struct {
+        ENetSocket socket;
+        std::vector<HandoffClient> clients;
+        std::vector<uint8_t> user_state;
+    } HandoffState;
+
+    // Sender side: connect to the replacement listening on path
+    bool send_handoff(const char* path, const HandoffState& state, uint32_t timeout);
+
+    // Receiver side: listen on path and wait for the old process
+    bool receive_handoff(const char* path, HandoffState& state, uint32_t timeout);
+
+    // The same over an already connected unix stream socket
+    bool write_handoff(int fd, const HandoffState& state);
+    bool read_handoff(int fd, HandoffState& state, uint32_t timeout);
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "net/packet.h"
+
+namespace snow {
+    typedef struct {
+        uint64_t tick;      // Server tick that sent it
+        uint64_t time;      // Server time the snapshot describes (us)
+        uint64_t arrival;   // Estimated server time it arrived (us)
+        Packet packet;
+    } Snapshot;
+
+    /*
+     * from and to point into the buffer; they are invalidated
+     * by the next push() or clear().
+     */
+    typedef struct {
+        const Snapshot* from;
+        const Snapshot* to;
+        float alpha;            // 0 at from, 1 at to, above 1 when extrapolating
+        bool extrapolating;
+    } SnapshotSample;
+
+    /*
+     * Client-side snapshot interpolation buffer.
+     *
+     * Snapshots are kept in a fixed-size ring ordered by snapshot time.
+     * Each arrival records its delay (arrival - time). The render delay
+     * follows the configured percentile of recent delays plus one
+     * snapshot interval, which is the smallest delay that still leaves
+     * a newer snapshot to interpolate towards most of the time.
+     *
+     * Times are in the server clock domain; pass
+     * Client::server_time_now() as the arrival time and
+     * render_time() argument. Client fills one of these per
+     * snapshot channel (see ChannelTable::enable_snapshots()).
+     */
+    class SnapshotBuffer {
+        public:
+            float percentile;       // Delay percentile to cover, default 0.95
+            uint64_t min_delay;     // Floor for the render delay (us)
+
+            SnapshotBuffer(size_t capacity = 32);
+
+            void push(uint64_t time, const Packet& packet, uint64_t arrival, uint64_t tick = 0);
+            uint64_t render_time(uint64_t server_now);
+            bool sample(uint64_t render_time, SnapshotSample& out);
+            void clear();
+
+            size_t size() const;
+            uint64_t get_render_delay() const;
+            uint64_t get_interval() const;
+            double get_extrapolation_rate() const;
+
+        private:
+            std::vector<Snapshot> m_snapshots;
+            size_t m_start;
+            size_t m_count;
+
+            // Recent arrival delays (us)
+            std::vector<int64_t> m_delays;
+            size_t m_next_delay;
+            size_t m_delay_count;
+
+            double m_interval;
+            double m_render_delay;
+            uint64_t m_samples;
+            uint64_t m_extrapolated;
+
+            Snapshot& at(size_t index);
+            void update_delay();
+    };
+}
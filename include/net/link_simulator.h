@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "enet/enet.h"
+
+#include "core/utils.h"
+
+namespace snow {
+    enum class JitterDistribution : uint8_t {
+        Uniform,    // Extra delay drawn from [0, jitter]
+        Normal,     // Extra delay drawn from |N(0, jitter)|
+    };
+
+    /*
+     * Impairments applied to one direction of a link.
+     * Probabilities are in [0, 1]; times are in milliseconds.
+     */
+    typedef struct {
+        uint32_t latency;               // Base one-way delay
+        uint32_t jitter;                // Spread of the random extra delay
+        JitterDistribution distribution;
+        float loss;                     // Independent loss outside bursts
+        float burst_enter;              // Chance per packet to start a loss burst
+        float burst_exit;               // Chance per packet to end a loss burst
+        float burst_loss;               // Loss while in a burst
+        float duplicate;                // Chance a packet is delivered twice
+        float reorder;                  // Chance a packet is held back
+        uint32_t reorder_delay;         // Extra delay for held back packets
+        uint32_t bandwidth;             // Bytes per second, 0 for unlimited
+        uint32_t queue_limit;           // Max bytes waiting for the link to send them, 0 for unlimited
+    } LinkConditions;
+
+    typedef struct {
+        uint64_t packets_forwarded;
+        uint64_t packets_dropped;
+        uint64_t packets_duplicated;
+        uint64_t packets_reordered;
+        uint64_t bytes_forwarded;
+    } LinkStats;
+
+    /*
+     * In-process UDP proxy that sits between clients and a Server.
+     * Clients connect to the simulator's port; each client gets its own
+     * upstream socket so the server still sees one peer per client.
+     * All random decisions come from per-route generators seeded from
+     * the simulator seed in route creation order, so a run with the same
+     * seed and traffic pattern makes the same drop/delay choices.
+     *
+     * Not thread-safe. Call service() from a single thread, or use
+     * run()/stop() to pump it on a dedicated thread.
+     */
+    class LinkSimulator {
+        public:
+            LinkSimulator(uint16_t port, const char* server_ip, uint16_t server_port, uint64_t seed = 0);
+            ~LinkSimulator();
+
+            bool init();
+            void set_default_conditions(const LinkConditions& upstream, const LinkConditions& downstream);
+            void set_conditions(const ENetAddress& client, const LinkConditions& upstream, const LinkConditions& downstream);
+            void service(uint32_t timeout);
+            void run();
+            void stop();
+            const LinkStats& get_stats() const;
+
+        private:
+            typedef struct {
+                LinkConditions conditions;
+                bool in_burst;
+                uint64_t link_free_at;      // When the emulated link finishes sending (us)
+            } LinkDirection;
+
+            typedef struct {
+                ENetAddress client;
+                ENetSocket socket;
+                uint64_t last_active;
+                uint64_t random_state;
+                LinkDirection upstream;
+                LinkDirection downstream;
+            } LinkRoute;
+
+            typedef struct {
+                uint64_t route;
+                bool upstream;
+                std::vector<uint8_t> data;
+            } DelayedPacket;
+
+            uint16_t m_port;
+            ENetAddress m_server_address;
+            ENetSocket m_socket;
+            uint64_t m_seed;
+            uint64_t m_routes_created;
+            uint64_t m_sequence;
+            std::atomic<bool> m_running;
+            LinkStats m_stats;
+
+            LinkConditions m_default_upstream;
+            LinkConditions m_default_downstream;
+            std::unordered_map<uint64_t, std::pair<LinkConditions, LinkConditions>> m_overrides;
+
+            std::unordered_map<uint64_t, LinkRoute> m_routes;
+
+            // Ordered by (delivery time, arrival order)
+            std::map<std::pair<uint64_t, uint64_t>, DelayedPacket> m_in_flight;
+
+            LinkRoute* get_route(const ENetAddress& client, uint64_t now);
+            void receive_upstream(uint64_t now);
+            void receive_downstream(uint64_t now);
+            void impair(LinkRoute& route, bool upstream, const uint8_t* data, size_t size, uint64_t now);
+            void deliver(uint64_t now);
+            void expire_routes(uint64_t now);
+    };
+}
@@ -6,13 +6,23 @@
 #include "enet/enet.h"
 
 #include "core/utils.h"
+#include "net/packet_io.h"
 
 namespace snow {
+    /*
+     * Packet header and payload pointing into a received buffer.
+     */
+    typedef struct {
+        Uuid uuid;
+        const uint8_t* data;
+        size_t size;
+    } PacketView;
+
     class Packet {
         public:
-            static constexpr char default_uuid[] = "00000000-0000-0000-0000-000000000000";
+            static constexpr Uuid default_uuid = {};
 
-            char uuid[_UUID_SIZE];
+            Uuid uuid;
             size_t size;
             std::unique_ptr<uint8_t[]> data;
 
@@ -21,11 +31,15 @@ namespace snow {
             Packet(Packet&& packet) noexcept;
             Packet& operator=(const Packet& packet);
             Packet& operator=(Packet&& packet) noexcept;
+            Packet(const PacketView& view);
             Packet(ENetEvent* event);
             ~Packet();
 
             size_t get_size() const noexcept;
             uint8_t* serialize() const;
-            bool deserialize(const uint8_t* buffer);
+            bool serialize(PacketWriter& writer) const;
+            ENetPacket* create_enet_packet(uint32_t flags, size_t headroom = 0) const;
+            bool deserialize(const uint8_t* buffer, size_t length);
+            static bool parse(const uint8_t* buffer, size_t length, PacketView& view);
     };
 }
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "core/uuid.h"
+
+namespace snow {
+    // Longest LEB128 encoding of a 64-bit value
+    constexpr size_t _VARINT_MAX_SIZE = 10;
+
+    size_t varint_size(uint64_t value);
+
+    /*
+     * Writes big-endian fixed-width values and varints into
+     * caller-owned storage. Never allocates. Once a write would
+     * overflow the buffer the writer fails and ignores further writes.
+     */
+    class PacketWriter {
+        public:
+            PacketWriter(uint8_t* buffer, size_t capacity);
+
+            bool write_u8(uint8_t value);
+            bool write_u16(uint16_t value);
+            bool write_u32(uint32_t value);
+            bool write_u64(uint64_t value);
+            bool write_float(float value);
+            bool write_varint(uint64_t value);
+            bool write_uuid(const Uuid& uuid);
+            bool write_bytes(const void* data, size_t size);
+            bool write_floats(const float* values, size_t count);
+
+            bool ok() const;
+            size_t size() const;
+            size_t remaining() const;
+            uint8_t* data() const;
+
+        private:
+            uint8_t* m_buffer;
+            size_t m_capacity;
+            size_t m_offset;
+            bool m_ok;
+
+            uint8_t* reserve(size_t size);
+    };
+
+    /*
+     * Reads values back out of a received buffer without copying it.
+     * Every read is checked against the buffer length; once a read
+     * fails the reader stays failed.
+     */
+    class PacketReader {
+        public:
+            PacketReader();
+            PacketReader(const uint8_t* buffer, size_t length);
+
+            bool read_u8(uint8_t& value);
+            bool read_u16(uint16_t& value);
+            bool read_u32(uint32_t& value);
+            bool read_u64(uint64_t& value);
+            bool read_float(float& value);
+            bool read_varint(uint64_t& value);
+            bool read_uuid(Uuid& uuid);
+            bool read_bytes(void* data, size_t size);
+            bool read_view(const uint8_t*& data, size_t size);
+            bool read_floats(float* values, size_t count);
+            bool skip(size_t size);
+
+            bool ok() const;
+            size_t offset() const;
+            size_t remaining() const;
+
+        private:
+            const uint8_t* m_buffer;
+            size_t m_length;
+            size_t m_offset;
+            bool m_ok;
+
+            const uint8_t* consume(size_t size);
+    };
+}
@@ -3,19 +3,25 @@
 #include <unordered_map>
 #include <vector>
 #include <queue>
+#include <deque>
+#include <atomic>
 #include <functional>
 
 #include "enet/enet.h"
 
 #include "core/utils.h"
 #include "net/packet.h"
+#include "net/channel.h"
+#include "net/control.h"
+#include "net/admission.h"
 
 namespace snow {
     const uint8_t _CHANNEL_RELIABLE = 0;
     const uint8_t _CHANNEL_UNRELIABLE = 1;
 
     typedef struct {
-        std::string uuid;
+        Uuid uuid;
+        ResumeSecret secret;    // Proves the client owns uuid on resume
         ENetPeer* peer;
     } ClientInfo;
 
@@ -27,39 +33,126 @@ namespace snow {
     typedef struct {
         Packet packet;
         ENetPeer* dest;
-        bool reliable;
+        uint32_t flags;
         uint8_t channel;
+        uint64_t queued_at;
     } QueuePacket;
 
+    typedef struct {
+        size_t soft_limit;      // Bytes; above this a peer is congested (0 = off)
+        size_t hard_limit;      // Bytes; above this a peer is kicked (0 = off)
+        size_t broadcast_limit; // Bytes of queued broadcasts, server-wide;
+                                // broadcasts beyond it are dropped (0 = off)
+    } BackpressureConfig;
+
+    typedef struct {
+        size_t queued;      // Bytes waiting to be sent
+        size_t in_transit;  // Reliable bytes sent but not yet acknowledged
+        bool congested;
+    } PeerSendStats;
+
+    typedef struct {
+        size_t queued;      // In our outgoing queues
+        size_t enet_queued; // In ENet's outgoing queues
+        size_t in_transit;
+        bool congested;
+        bool over_limit;    // Kick at the next flush
+    } SendBudget;
+
+    typedef struct {
+        uint64_t deadline;  // ms
+    } PendingHandshake;
+
+    typedef struct {
+        ResumeSecret secret;
+        uint64_t expires;   // ms
+    } ResumableClient;
+
+    typedef struct {
+        Packet packet;
+        uint8_t channel;
+        bool dirty;             // Holds a value that hasn't been sent yet
+        ENetPacket* in_flight;  // Last value handed to ENet
+    } StateSlot;
+
+    class Context;
+
+    /*
+     * Not thread safe; see Context for the threading contract.
+     */
     class Server {
+        friend class Context;
+
         public:
             uint16_t port;
             uint16_t tick_rate;  // Ticks per second
             uint32_t max_clients;
+            ChannelTable channels;  // Must be set before init()
+            AdmissionConfig admission;
+            BackpressureConfig backpressure;
 
             Server(uint16_t port = 8000, uint32_t max_clients = 32);
             ~Server();
             void init();
+            bool init_from_handoff(const char* path, uint32_t timeout);
             void start(
                 std::function<void(Server&)> user_loop,
                 std::function<bool(Server&, ENetEvent&)> connect_callback = nullptr,
                 std::function<void(Server&, ENetEvent&)> disconnect_callback = nullptr
             );
+            void send_packet(const Packet& packet, ENetPeer* dest, uint8_t channel);
             void send_packet(const Packet& packet, ENetPeer* dest, bool reliable, uint8_t channel);
+            void broadcast_packet(const Packet& packet, uint8_t channel);
             void broadcast_packet(const Packet& packet, bool reliable, uint8_t channel);
+            void set_state(ENetPeer* peer, uint32_t key, const Packet& packet, uint8_t channel = _CHANNEL_UNRELIABLE);
+            void broadcast_state(uint32_t key, const Packet& packet, uint8_t channel = _CHANNEL_UNRELIABLE);
+            void clear_state(ENetPeer* peer, uint32_t key);
+            const ChannelStats& get_channel_stats(uint8_t channel) const;
+            PeerSendStats get_send_stats(ENetPeer* peer) const;
+            void set_backpressure_callback(std::function<void(Server&, ENetPeer*, bool)> callback);
+            uint64_t get_tick() const;
             Message* read_packet();
 
+            void stop();
+            bool drain(uint32_t timeout);
+            bool handoff(const char* path, uint32_t timeout, const std::vector<uint8_t>& user_state = {});
+            const std::vector<uint8_t>& get_handoff_state() const;
+
         private:
             ENetHost* m_host;
             Message m_message_cache;
 
+            // Tick counter and when the current tick started (us)
+            uint64_t m_tick;
+            uint64_t m_tick_start;
+            bool m_flush_control;
+
+            // Holds a reference on ENet's global state
+            bool m_enet_acquired;
+
+            // Shutdown state
+            std::atomic<bool> m_running;
+            bool m_accepting;
+            bool m_handing_off;
+
+            // Clients handed over by a previous process, by UUID,
+            // with the secret that proves a claim and when it expires
+            std::unordered_map<Uuid, ResumableClient, UuidHash> m_resumable;
+            std::vector<uint8_t> m_handoff_state;
+
+            // Admission runs in intercept(); only resuming connections
+            // that haven't sent their UUID yet are tracked per peer
+            Admission m_admission;
+            std::unordered_map<ENetPeer*, PendingHandshake> m_pending_handshakes;
+
             // User function pointers
             std::function<void(Server&)> m_user_loop;
             std::function<bool(Server&, ENetEvent&)> m_user_connect_callback;
             std::function<void(Server&, ENetEvent&)> m_user_disconnect_callback;
+            std::function<void(Server&, ENetPeer*, bool)> m_user_backpressure_callback;
 
             // Client lookup
-            std::unordered_map<std::string, ENetPeer*> m_client_lookup;
+            std::unordered_map<Uuid, ENetPeer*, UuidHash> m_client_lookup;
 
             // Client list
             std::vector<ClientInfo> m_clients;
@@ -68,14 +161,47 @@ namespace snow {
             // NOTE: using std::queue here might become an
             // issue in the future.
             std::queue<Message> m_incoming_messages;
-            std::queue<QueuePacket> m_outgoing_messages;
 
+            // Outgoing messages, one queue per channel
+            std::vector<std::deque<QueuePacket>> m_outgoing_messages;
+
+            // Send-side memory accounting per client
+            std::unordered_map<ENetPeer*, SendBudget> m_send_budgets;
+            size_t m_congested_count;
+
+            // Queued broadcast bytes. Shared by every client, so they
+            // count against backpressure.broadcast_limit, never a peer.
+            size_t m_broadcast_queued;
+
+            // Latest-value state slots, keyed by peer then user key
+            std::unordered_map<ENetPeer*, std::unordered_map<uint32_t, StateSlot>> m_state_slots;
+
+            static int intercept(ENetHost* host, ENetEvent* event);
+            void attach_host();
+            void detach_host();
             void poll_events();
-            void handle_new_connection(ENetEvent& event);
+            void handle_new_connection(ENetEvent& event, const Uuid& uuid);
+            bool admit_connect(const ENetProtocolConnect* command);
+            void accept_connection(ENetEvent& event);
+            void complete_handshake(ENetPeer* peer, uint32_t mode, const Uuid& uuid, const ResumeSecret& secret);
+            void expire_handshakes();
+            void reject_pending_handshakes(uint32_t reason);
             void main_loop();
+            void tick();
             void disconnect_client(ENetEvent& event);
-
-            void _send_packet_immediate(const Packet& packet, ENetPeer* dest, bool reliable, uint8_t channel);
-            void _broadcast_packet_immediate(const Packet& packet, bool reliable, uint8_t channel);
+            void handle_control_message(ENetEvent& event, uint64_t received_at);
+            void queue_packet(const Packet& packet, ENetPeer* dest, uint32_t flags, uint8_t channel);
+            void flush_outgoing();
+            void flush_state_slots();
+            void release_state_slots(ENetPeer* peer);
+            void track_queued(const QueuePacket& message, bool added);
+            void update_send_budgets();
+            void kick_client(ENetPeer* peer, uint32_t reason);
+            bool wait_for_acknowledgements(uint64_t deadline);
+            void drain_events(uint32_t timeout);
+
+            ENetPacket* create_enet_packet(const Packet& packet, uint32_t flags, uint8_t channel) const;
+            size_t _send_packet_immediate(const Packet& packet, ENetPeer* dest, uint32_t flags, uint8_t channel);
+            size_t _broadcast_packet_immediate(const Packet& packet, uint32_t flags, uint8_t channel);
     };
 }
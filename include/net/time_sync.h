@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace snow {
+    typedef struct {
+        int64_t offset;     // Server clock minus client clock (us)
+        uint64_t rtt;       // Round trip minus server processing time (us)
+    } TimeSyncSample;
+
+    /*
+     * NTP-style clock offset estimator.
+     * Keeps a window of recent samples, trusts only the ones with the
+     * lowest round trip time (they have the least queueing asymmetry),
+     * and smooths the median of those towards the current estimate.
+     * All times are microseconds on the respective machine's
+     * get_monotonic_time_us() clock.
+     */
+    class TimeSync {
+        public:
+            TimeSync();
+
+            void add_sample(
+                uint64_t client_send,
+                uint64_t server_receive,
+                uint64_t server_send,
+                uint64_t client_receive
+            );
+            void set_tick_reference(uint64_t tick, uint64_t tick_start, uint16_t tick_rate);
+            void reset();
+
+            bool synchronized() const;
+            int64_t offset() const;
+            uint64_t rtt() const;
+            uint64_t server_time(uint64_t local_time) const;
+            double server_tick(uint64_t local_time) const;
+            uint32_t request_interval() const;
+
+        private:
+            std::vector<TimeSyncSample> m_samples;
+            size_t m_next_sample;
+            uint64_t m_sample_count;
+
+            double m_offset;
+            uint64_t m_rtt;
+            bool m_synchronized;
+
+            uint64_t m_tick;
+            uint64_t m_tick_start;
+            uint16_t m_tick_rate;
+
+            void update_estimate();
+    };
+}
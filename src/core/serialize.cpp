@@ -0,0 +1,357 @@
+#include <cmath>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #include <immintrin.h>
+    #define SNOW_X86_KERNELS 1
+#endif
+
+#include "core/serialize.h"
+
+namespace snow {
+    namespace {
+        #if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            constexpr bool host_is_big_endian = true;
+        #else
+            constexpr bool host_is_big_endian = false;
+        #endif
+
+        inline uint32_t bswap32(uint32_t value) {
+            #if defined(__GNUC__)
+                return __builtin_bswap32(value);
+            #else
+                return (value >> 24) | ((value >> 8) & 0x0000FF00) |
+                       ((value << 8) & 0x00FF0000) | (value << 24);
+            #endif
+        }
+
+        inline uint64_t bswap64(uint64_t value) {
+            #if defined(__GNUC__)
+                return __builtin_bswap64(value);
+            #else
+                return ((uint64_t)bswap32((uint32_t)value) << 32) | bswap32((uint32_t)(value >> 32));
+            #endif
+        }
+
+        void swap32_scalar(uint8_t* dst, const uint8_t* src, size_t count) {
+            for (size_t i = 0; i < count; i++) {
+                uint32_t value;
+                memcpy(&value, src + i * 4, 4);
+                value = bswap32(value);
+                memcpy(dst + i * 4, &value, 4);
+            }
+        }
+
+        void swap64_scalar(uint8_t* dst, const uint8_t* src, size_t count) {
+            for (size_t i = 0; i < count; i++) {
+                uint64_t value;
+                memcpy(&value, src + i * 8, 8);
+                value = bswap64(value);
+                memcpy(dst + i * 8, &value, 8);
+            }
+        }
+
+        #ifdef SNOW_X86_KERNELS
+            /*
+             * SSE2 has no byte shuffle, so swap bytes within
+             * 16-bit words and then reverse the words.
+             */
+            inline __m128i sse2_swap16(__m128i v) {
+                return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+            }
+
+            void swap32_sse2(uint8_t* dst, const uint8_t* src, size_t count) {
+                size_t i = 0;
+                for (; i + 4 <= count; i += 4) {
+                    __m128i v = _mm_loadu_si128((const __m128i*)(src + i * 4));
+                    v = sse2_swap16(v);
+                    v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+                    v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+                    _mm_storeu_si128((__m128i*)(dst + i * 4), v);
+                }
+                swap32_scalar(dst + i * 4, src + i * 4, count - i);
+            }
+
+            void swap64_sse2(uint8_t* dst, const uint8_t* src, size_t count) {
+                size_t i = 0;
+                for (; i + 2 <= count; i += 2) {
+                    __m128i v = _mm_loadu_si128((const __m128i*)(src + i * 8));
+                    v = sse2_swap16(v);
+                    v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+                    v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+                    _mm_storeu_si128((__m128i*)(dst + i * 8), v);
+                }
+                swap64_scalar(dst + i * 8, src + i * 8, count - i);
+            }
+
+            __attribute__((target("avx2")))
+            void swap32_avx2(uint8_t* dst, const uint8_t* src, size_t count) {
+                const __m256i mask = _mm256_setr_epi8(
+                    3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                    3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12
+                );
+                size_t i = 0;
+                for (; i + 8 <= count; i += 8) {
+                    __m256i v = _mm256_loadu_si256((const __m256i*)(src + i * 4));
+                    _mm256_storeu_si256((__m256i*)(dst + i * 4), _mm256_shuffle_epi8(v, mask));
+                }
+                swap32_scalar(dst + i * 4, src + i * 4, count - i);
+            }
+
+            __attribute__((target("avx2")))
+            void swap64_avx2(uint8_t* dst, const uint8_t* src, size_t count) {
+                const __m256i mask = _mm256_setr_epi8(
+                    7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+                    7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8
+                );
+                size_t i = 0;
+                for (; i + 4 <= count; i += 4) {
+                    __m256i v = _mm256_loadu_si256((const __m256i*)(src + i * 8));
+                    _mm256_storeu_si256((__m256i*)(dst + i * 8), _mm256_shuffle_epi8(v, mask));
+                }
+                swap64_scalar(dst + i * 8, src + i * 8, count - i);
+            }
+        #endif
+
+        typedef void (*SwapKernel)(uint8_t*, const uint8_t*, size_t);
+
+        typedef struct {
+            SwapKernel swap32;
+            SwapKernel swap64;
+            const char* name;
+        } Kernels;
+
+        /*
+         * Pick the widest kernel the CPU supports, once.
+         */
+        const Kernels& kernels() {
+            static const Kernels selected = []() {
+                #ifdef SNOW_X86_KERNELS
+                    __builtin_cpu_init();
+                    if (__builtin_cpu_supports("avx2")) {
+                        return Kernels{ swap32_avx2, swap64_avx2, "avx2" };
+                    }
+                    return Kernels{ swap32_sse2, swap64_sse2, "sse2" };
+                #else
+                    return Kernels{ swap32_scalar, swap64_scalar, "scalar" };
+                #endif
+            }();
+            return selected;
+        }
+
+        void swap32(uint8_t* dst, const uint8_t* src, size_t count) {
+            if (host_is_big_endian) {
+                memmove(dst, src, count * 4);
+                return;
+            }
+            kernels().swap32(dst, src, count);
+        }
+
+        void swap64(uint8_t* dst, const uint8_t* src, size_t count) {
+            if (host_is_big_endian) {
+                memmove(dst, src, count * 8);
+                return;
+            }
+            kernels().swap64(dst, src, count);
+        }
+    }
+
+    void serialize_floats(uint8_t* buffer, const float* values, size_t count) {
+        swap32(buffer, (const uint8_t*)values, count);
+    }
+
+    void deserialize_floats(const uint8_t* buffer, float* values, size_t count) {
+        swap32((uint8_t*)values, buffer, count);
+    }
+
+    void serialize_u32s(uint8_t* buffer, const uint32_t* values, size_t count) {
+        swap32(buffer, (const uint8_t*)values, count);
+    }
+
+    void deserialize_u32s(const uint8_t* buffer, uint32_t* values, size_t count) {
+        swap32((uint8_t*)values, buffer, count);
+    }
+
+    void serialize_u64s(uint8_t* buffer, const uint64_t* values, size_t count) {
+        swap64(buffer, (const uint8_t*)values, count);
+    }
+
+    void deserialize_u64s(const uint8_t* buffer, uint64_t* values, size_t count) {
+        swap64((uint8_t*)values, buffer, count);
+    }
+
+    /*
+     * Map value from [min, max] onto an unsigned integer of the given width.
+     * Values outside the range are clamped.
+     */
+    uint32_t quantize_float(float value, float min, float max, uint32_t bits) {
+        const double steps = (bits >= 32) ? 4294967295.0 : (double)((1u << bits) - 1);
+
+        if (!(value > min)) return 0;
+        if (value >= max) return (uint32_t)steps;
+
+        double normalized = ((double)value - min) / ((double)max - min);
+        return (uint32_t)(normalized * steps + 0.5);
+    }
+
+    float dequantize_float(uint32_t value, float min, float max, uint32_t bits) {
+        const double steps = (bits >= 32) ? 4294967295.0 : (double)((1u << bits) - 1);
+        return (float)(min + ((double)value / steps) * ((double)max - min));
+    }
+
+    /*
+     * Round-to-nearest-even float to half conversion.
+     */
+    uint16_t float_to_half(float value) {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(float));
+
+        uint32_t sign = (bits >> 16) & 0x8000;
+        uint32_t exponent = (bits >> 23) & 0xFF;
+        uint32_t mantissa = bits & 0x007FFFFF;
+
+        // NaN and infinity
+        if (exponent == 0xFF) {
+            return (uint16_t)(sign | 0x7C00 | (mantissa ? 0x0200 : 0));
+        }
+
+        int32_t half_exponent = (int32_t)exponent - 127 + 15;
+
+        // Overflow to infinity
+        if (half_exponent >= 0x1F) {
+            return (uint16_t)(sign | 0x7C00);
+        }
+
+        // Subnormal or zero
+        if (half_exponent <= 0) {
+            if (half_exponent < -10) {
+                return (uint16_t)sign;
+            }
+            mantissa |= 0x00800000;
+            uint32_t shift = (uint32_t)(14 - half_exponent);
+            uint32_t half_mantissa = mantissa >> shift;
+            uint32_t remainder = mantissa & ((1u << shift) - 1);
+            uint32_t halfway = 1u << (shift - 1);
+            if (remainder > halfway || (remainder == halfway && (half_mantissa & 1))) {
+                half_mantissa++;
+            }
+            return (uint16_t)(sign | half_mantissa);
+        }
+
+        uint32_t half = sign | ((uint32_t)half_exponent << 10) | (mantissa >> 13);
+        uint32_t remainder = mantissa & 0x1FFF;
+        if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1))) {
+            // Carry may roll into the exponent, which is still correct
+            half++;
+        }
+        return (uint16_t)half;
+    }
+
+    float half_to_float(uint16_t value) {
+        uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+        uint32_t exponent = (value >> 10) & 0x1F;
+        uint32_t mantissa = value & 0x03FF;
+        uint32_t bits;
+
+        if (exponent == 0) {
+            if (mantissa == 0) {
+                bits = sign;
+            }
+            else {
+                // Normalize the subnormal
+                exponent = 127 - 15 + 1;
+                while ((mantissa & 0x0400) == 0) {
+                    mantissa <<= 1;
+                    exponent--;
+                }
+                mantissa &= 0x03FF;
+                bits = sign | (exponent << 23) | (mantissa << 13);
+            }
+        }
+        else if (exponent == 0x1F) {
+            bits = sign | 0x7F800000 | (mantissa << 13);
+        }
+        else {
+            bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+        }
+
+        float result;
+        memcpy(&result, &bits, sizeof(float));
+        return result;
+    }
+
+    void serialize_halfs(uint8_t* buffer, const float* values, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            uint16_t half = float_to_half(values[i]);
+            buffer[i * 2] = (uint8_t)(half >> 8);
+            buffer[i * 2 + 1] = (uint8_t)(half & 0xFF);
+        }
+    }
+
+    void deserialize_halfs(const uint8_t* buffer, float* values, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            uint16_t half = (uint16_t)((buffer[i * 2] << 8) | buffer[i * 2 + 1]);
+            values[i] = half_to_float(half);
+        }
+    }
+
+    namespace {
+        // The three smallest components of a unit quaternion
+        // always lie within +-1/sqrt(2).
+        constexpr float quaternion_limit = 0.70710678118f;
+        constexpr uint32_t quaternion_bits = 10;
+    }
+
+    /*
+     * Packs a unit quaternion as the index of its largest component
+     * (2 bits) followed by the other three at 10 bits each.
+     */
+    uint32_t quantize_quaternion(const float quaternion[4]) {
+        uint32_t largest = 0;
+        for (uint32_t i = 1; i < 4; i++) {
+            if (std::fabs(quaternion[i]) > std::fabs(quaternion[largest])) {
+                largest = i;
+            }
+        }
+
+        // q and -q are the same rotation; make the dropped component positive
+        float sign = (quaternion[largest] < 0.0f) ? -1.0f : 1.0f;
+
+        uint32_t packed = largest << 30;
+        uint32_t shift = 20;
+        for (uint32_t i = 0; i < 4; i++) {
+            if (i == largest) continue;
+
+            uint32_t component = quantize_float(
+                quaternion[i] * sign, -quaternion_limit, quaternion_limit, quaternion_bits
+            );
+            packed |= component << shift;
+            shift -= quaternion_bits;
+        }
+        return packed;
+    }
+
+    void dequantize_quaternion(uint32_t packed, float quaternion[4]) {
+        uint32_t largest = packed >> 30;
+        uint32_t shift = 20;
+        float sum = 0.0f;
+
+        for (uint32_t i = 0; i < 4; i++) {
+            if (i == largest) continue;
+
+            uint32_t component = (packed >> shift) & ((1u << quaternion_bits) - 1);
+            quaternion[i] = dequantize_float(
+                component, -quaternion_limit, quaternion_limit, quaternion_bits
+            );
+            sum += quaternion[i] * quaternion[i];
+            shift -= quaternion_bits;
+        }
+
+        float remaining = 1.0f - sum;
+        quaternion[largest] = (remaining > 0.0f) ? std::sqrt(remaining) : 0.0f;
+    }
+
+    const char* serialize_kernel_name() {
+        return kernels().name;
+    }
+}
@@ -5,7 +5,6 @@
 #endif
 #include <cstring>
 #include <chrono>
-#include <random>
 
 #include "core/utils.h"
 
@@ -29,11 +28,14 @@ namespace snow {
     }
 
     void serialize_uint64_t(uint8_t* buffer, uint64_t value) {
-        *(uint64_t*)buffer = htonll(value);
+        value = htonll(value);
+        memcpy(buffer, &value, sizeof(uint64_t));
     }
 
     uint64_t deserialize_uint64_t(const uint8_t* buffer) {
-        return ntohll(*(uint64_t*)buffer);
+        uint64_t value;
+        memcpy(&value, buffer, sizeof(uint64_t));
+        return ntohll(value);
     }
 
     /**
@@ -50,24 +52,14 @@ namespace snow {
     }
 
     /**
-     * Generates a random UUIDv4 string.
+     * Returns a monotonic timestamp in microseconds.
+     * Only meaningful relative to other calls on
+     * the same machine; the epoch is unspecified.
      */
-    std::string generate_uuid() {
-        static std::random_device dev;
-        static std::mt19937 rng(dev());
-
-        std::uniform_int_distribution<int> dist(0, 15);
-
-        const char* v = "0123456789abcdef";
-        const bool dash[] = { 0, 0, 0, 0, 1, 0, 1, 0, 1, 0, 1, 0, 0, 0, 0, 0 };
-
-        std::string res;
-        for (int i = 0; i < 16; i++) {
-            if (dash[i]) res += "-";
-            res += v[dist(rng)];
-            res += v[dist(rng)];
-        }
-        return res;
+    uint64_t get_monotonic_time_us() {
+        const auto clock = std::chrono::steady_clock::now();
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            clock.time_since_epoch()).count();
     }
 
     /**
@@ -76,6 +68,8 @@ namespace snow {
     uint64_t htonll(uint64_t value) {
         #if __BIG_ENDIAN__
             return value;
+        #elif defined(__GNUC__)
+            return __builtin_bswap64(value);
         #else
             return (uint64_t)htonl((uint32_t)(value >> 32)) | (uint64_t)htonl((uint32_t)(value & 0xFFFFFFFF)) << 32;
         #endif
@@ -87,6 +81,8 @@ namespace snow {
     uint64_t ntohll(uint64_t value) {
         #if __BIG_ENDIAN__
             return value;
+        #elif defined(__GNUC__)
+            return __builtin_bswap64(value);
         #else
             return (uint64_t)ntohl((uint32_t)(value >> 32)) | (uint64_t)ntohl((uint32_t)(value & 0xFFFFFFFF)) << 32;
         #endif
@@ -0,0 +1,116 @@
+#ifdef __linux__
+    #include <sys/random.h>
+#endif
+#include <cerrno>
+#include <cstring>
+#include <random>
+
+#include "core/uuid.h"
+
+namespace snow {
+    namespace {
+        uint64_t rotl(uint64_t x, int k) {
+            return (x << k) | (x >> (64 - k));
+        }
+
+        uint64_t splitmix64(uint64_t& state) {
+            uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            return z ^ (z >> 31);
+        }
+
+        /*
+         * xoshiro256** generator, one per thread.
+         * Seeded from the OS on first use.
+         */
+        class UuidGenerator {
+            public:
+                UuidGenerator() {
+                    uint64_t seed = 0;
+
+                    #ifdef __linux__
+                        if (getrandom(&seed, sizeof(seed), 0) != sizeof(seed)) {
+                            seed = 0;
+                        }
+                    #endif
+                    if (seed == 0) {
+                        std::random_device dev;
+                        seed = ((uint64_t)dev() << 32) | dev();
+                    }
+
+                    for (int i = 0; i < 4; i++) {
+                        this->m_state[i] = splitmix64(seed);
+                    }
+                }
+
+                uint64_t next() {
+                    const uint64_t result = rotl(this->m_state[1] * 5, 7) * 9;
+                    const uint64_t t = this->m_state[1] << 17;
+
+                    this->m_state[2] ^= this->m_state[0];
+                    this->m_state[3] ^= this->m_state[1];
+                    this->m_state[1] ^= this->m_state[2];
+                    this->m_state[0] ^= this->m_state[3];
+                    this->m_state[2] ^= t;
+                    this->m_state[3] = rotl(this->m_state[3], 45);
+
+                    return result;
+                }
+
+            private:
+                uint64_t m_state[4];
+        };
+    }
+
+    /**
+     * Generates a random UUIDv4.
+     * Thread-safe: each thread draws from its own generator.
+     */
+    Uuid generate_uuid() {
+        thread_local UuidGenerator generator;
+
+        uint64_t high = generator.next();
+        uint64_t low = generator.next();
+
+        Uuid uuid;
+        memcpy(uuid.bytes, &high, sizeof(uint64_t));
+        memcpy(uuid.bytes + sizeof(uint64_t), &low, sizeof(uint64_t));
+
+        // Version 4, RFC 4122 variant
+        uuid.bytes[6] = (uuid.bytes[6] & 0x0F) | 0x40;
+        uuid.bytes[8] = (uuid.bytes[8] & 0x3F) | 0x80;
+
+        return uuid;
+    }
+
+    /*
+     * Fills data from getrandom(), falling back to std::random_device.
+     * Unlike generate_uuid() nothing here can be predicted from
+     * earlier output, so it is safe for secrets and keys.
+     */
+    void fill_secure_random(uint8_t* data, size_t size) {
+        size_t filled = 0;
+
+        #ifdef __linux__
+            while (filled < size) {
+                ssize_t result = getrandom(data + filled, size - filled, 0);
+                if (result < 0) {
+                    if (errno == EINTR) continue;
+                    break;
+                }
+                filled += (size_t)result;
+            }
+        #endif
+
+        if (filled < size) {
+            std::random_device dev;
+            while (filled < size) {
+                uint32_t value = dev();
+                size_t count = (size - filled < sizeof(value)) ? size - filled : sizeof(value);
+                memcpy(data + filled, &value, count);
+                filled += count;
+            }
+        }
+    }
+}
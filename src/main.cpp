@@ -21,9 +21,9 @@ int main(int argc, char* argv[]) {
             Message* msg = server.read_packet();
             while (msg != nullptr) {
                 Packet& packet = msg->packet;
-                std::cout << "[SERVER] Received message from " << packet.uuid << std::endl;
+                std::cout << "[SERVER] Received message from " << packet.uuid.to_string() << std::endl;
 
-                server.broadcast_packet(packet, true, snow::_CHANNEL_RELIABLE);
+                server.broadcast_packet(packet, snow::_CHANNEL_RELIABLE);
 
                 msg = server.read_packet();
             }
@@ -39,7 +39,8 @@ int main(int argc, char* argv[]) {
         else {
             std::string message = "Hello World";
 
-            while (1) {
+            // Keep polling through a server handoff
+            while (client.is_connected() || client.is_connecting()) {
                 debug_log("[CLIENT] Polling events...");
                 client.poll_events([](ENetEvent& event) {
                     Packet packet(&event);
@@ -54,12 +55,12 @@ int main(int argc, char* argv[]) {
 
                 // TODO make function for this
                 Packet packet;
-                strcpy(packet.uuid, client.get_uuid().c_str());
+                packet.uuid = client.get_uuid();
                 packet.size = message.size() + 1;
                 packet.data = std::make_unique<uint8_t[]>(packet.size);
                 memcpy(packet.data.get(), message.data(), packet.size);
 
-                client.send_packet(packet, true, snow::_CHANNEL_RELIABLE);
+                client.send_packet(packet, snow::_CHANNEL_RELIABLE);
 
                 std::this_thread::sleep_for(std::chrono::milliseconds(1000));
             }
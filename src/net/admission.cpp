@@ -0,0 +1,179 @@
+#include <algorithm>
+
+#include "net/admission.h"
+#include "net/control.h"
+#include "core/utils.h"
+
+namespace snow {
+    namespace {
+        // Buckets are pruned at most this often (ms)
+        constexpr uint64_t prune_interval = 10000;
+
+        // Hard cap on tracked source addresses
+        constexpr size_t max_buckets = 65536;
+
+        inline uint64_t rotl(uint64_t x, int b) {
+            return (x << b) | (x >> (64 - b));
+        }
+
+        inline void sip_round(uint64_t& v0, uint64_t& v1, uint64_t& v2, uint64_t& v3) {
+            v0 += v1; v1 = rotl(v1, 13); v1 ^= v0; v0 = rotl(v0, 32);
+            v2 += v3; v3 = rotl(v3, 16); v3 ^= v2;
+            v0 += v3; v3 = rotl(v3, 21); v3 ^= v0;
+            v2 += v1; v1 = rotl(v1, 17); v1 ^= v2; v2 = rotl(v2, 32);
+        }
+
+        /*
+         * SipHash-2-4 over whole 64-bit words.
+         */
+        uint64_t siphash(const uint64_t key[2], const uint64_t* words, size_t count) {
+            uint64_t v0 = key[0] ^ 0x736F6D6570736575ULL;
+            uint64_t v1 = key[1] ^ 0x646F72616E646F6DULL;
+            uint64_t v2 = key[0] ^ 0x6C7967656E657261ULL;
+            uint64_t v3 = key[1] ^ 0x7465646279746573ULL;
+
+            for (size_t i = 0; i < count; i++) {
+                v3 ^= words[i];
+                sip_round(v0, v1, v2, v3);
+                sip_round(v0, v1, v2, v3);
+                v0 ^= words[i];
+            }
+
+            uint64_t last = (uint64_t)(count * 8) << 56;
+            v3 ^= last;
+            sip_round(v0, v1, v2, v3);
+            sip_round(v0, v1, v2, v3);
+            v0 ^= last;
+
+            v2 ^= 0xFF;
+            for (int i = 0; i < 4; i++) {
+                sip_round(v0, v1, v2, v3);
+            }
+            return v0 ^ v1 ^ v2 ^ v3;
+        }
+    }
+
+    /*
+     * Picks a fresh random cookie key; cookies from
+     * other Admission instances never validate. The key comes
+     * from the OS, not the UUID generator, whose output every
+     * client gets to see.
+     */
+    Admission::Admission() {
+        fill_secure_random((uint8_t*)this->m_key, sizeof(this->m_key));
+        this->m_last_prune = 0;
+    }
+
+    AdmissionConfig Admission::defaults() {
+        return (AdmissionConfig){
+            .rate = 2.0f,
+            .burst = 5.0f,
+            .max_pending = 64,
+            .handshake_timeout = 5000,
+        };
+    }
+
+    /*
+     * Decide whether a new connection may start a handshake.
+     * pending is the number of handshakes already in progress.
+     * Only call this for connects with a valid cookie, so buckets
+     * belong to addresses that can receive our replies.
+     */
+    AdmissionResult Admission::admit(const AdmissionConfig& config, const ENetAddress& address, size_t pending, uint64_t now) {
+        if (pending >= config.max_pending) {
+            return AdmissionResult::Busy;
+        }
+
+        this->prune(config, now);
+
+        auto bucket_it = this->m_buckets.find(address.host);
+        if (bucket_it == this->m_buckets.end()) {
+            // Make room rather than turn every new address away;
+            // dropping a bucket only forgives that one address
+            if (this->m_buckets.size() >= max_buckets) {
+                this->m_buckets.erase(this->m_buckets.begin());
+            }
+            bucket_it = this->m_buckets.emplace(address.host, (TokenBucket){
+                .tokens = config.burst,
+                .updated = now,
+            }).first;
+        }
+
+        TokenBucket& bucket = bucket_it->second;
+        float elapsed = (float)(now - bucket.updated) / 1000.0f;
+        bucket.tokens = std::min(config.burst, bucket.tokens + elapsed * config.rate);
+        bucket.updated = now;
+
+        if (bucket.tokens < 1.0f) {
+            return AdmissionResult::RateLimited;
+        }
+        bucket.tokens -= 1.0f;
+
+        return AdmissionResult::Accept;
+    }
+
+    /*
+     * Connect data for a client at address to retry with.
+     * Valid for one to two handshake timeouts.
+     */
+    uint32_t Admission::make_cookie(const AdmissionConfig& config, const ENetAddress& address, uint32_t mode, uint64_t now) const {
+        uint64_t epoch = now / std::max<uint64_t>(config.handshake_timeout, 1);
+        return this->cookie(address, mode & _CONNECT_MODE_MASK, epoch);
+    }
+
+    /*
+     * Valid if we issued the cookie to this address
+     * in the current or the previous epoch.
+     */
+    bool Admission::check_cookie(const AdmissionConfig& config, const ENetAddress& address, uint32_t cookie, uint64_t now) const {
+        uint64_t epoch = now / std::max<uint64_t>(config.handshake_timeout, 1);
+        uint32_t mode = cookie & _CONNECT_MODE_MASK;
+
+        if (this->cookie(address, mode, epoch) == cookie) {
+            return true;
+        }
+        return epoch > 0 && this->cookie(address, mode, epoch - 1) == cookie;
+    }
+
+    /*
+     * Hash in the upper 31 bits, mode in the low bit. Never
+     * leaves the hash bits zero; that means "no cookie yet".
+     */
+    uint32_t Admission::cookie(const ENetAddress& address, uint32_t mode, uint64_t epoch) const {
+        const uint64_t words[3] = {
+            ((uint64_t)address.host << 16) | address.port,
+            mode,
+            epoch,
+        };
+
+        uint32_t hash = (uint32_t)siphash(this->m_key, words, 3) & ~_CONNECT_MODE_MASK;
+        if (hash == 0) {
+            hash = _CONNECT_MODE_MASK + 1;
+        }
+        return hash | mode;
+    }
+
+    /*
+     * Forget addresses whose bucket has refilled completely;
+     * they behave exactly like new addresses.
+     */
+    void Admission::prune(const AdmissionConfig& config, uint64_t now) {
+        if (now - this->m_last_prune < prune_interval) {
+            return;
+        }
+        this->m_last_prune = now;
+
+        auto bucket_it = this->m_buckets.begin();
+        while (bucket_it != this->m_buckets.end()) {
+            const TokenBucket& bucket = bucket_it->second;
+            float elapsed = (float)(now - bucket.updated) / 1000.0f;
+
+            if (bucket.tokens + elapsed * config.rate >= config.burst) {
+                bucket_it = this->m_buckets.erase(bucket_it);
+            }
+            else {
+                bucket_it++;
+            }
+        }
+    }
+}
@@ -0,0 +1,162 @@
+#include "enet/enet.h"
+
+#include "net/channel.h"
+#include "core/utils.h"
+
+namespace snow {
+    /*
+     * Creates an empty channel table.
+     * Use ChannelTable::defaults() for the standard
+     * reliable/unreliable layout.
+     */
+    ChannelTable::ChannelTable() {}
+
+    /*
+     * Default channel layout. Channel ids match
+     * _CHANNEL_RELIABLE and _CHANNEL_UNRELIABLE.
+     */
+    ChannelTable ChannelTable::defaults() {
+        ChannelTable table;
+        table.add_channel(DeliveryMode::ReliableOrdered);
+        table.add_channel(DeliveryMode::UnreliableSequenced);
+        return table;
+    }
+
+    /*
+     * Appends a channel to the table and returns its id,
+     * or _CHANNEL_INVALID if the table is full.
+     */
+    uint8_t ChannelTable::add_channel(DeliveryMode mode, uint32_t queue_limit, DropPolicy drop_policy) {
+        // First ENet channel is reserved for control messages
+        if (this->m_configs.size() >= ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT - 1) {
+            debug_error("[CHANNEL] Channel limit reached.");
+            return _CHANNEL_INVALID;
+        }
+
+        ChannelConfig config = {
+            .mode = mode,
+            .queue_limit = queue_limit,
+            .drop_policy = drop_policy,
+            .snapshots = false,
+        };
+        this->m_configs.push_back(config);
+        this->m_stats.push_back(ChannelStats{});
+
+        return (uint8_t)(this->m_configs.size() - 1);
+    }
+
+    /*
+     * Make channel a snapshot channel. The server stamps every packet
+     * sent on it with the tick it was sent in, and clients hand them
+     * to a SnapshotBuffer instead of the poll_events() callback.
+     * Both ends must agree, like the rest of the table.
+     */
+    void ChannelTable::enable_snapshots(uint8_t channel) {
+        if (channel >= this->m_configs.size()) {
+            debug_error("[CHANNEL] Channel %u does not exist.", channel);
+            return;
+        }
+        this->m_configs[channel].snapshots = true;
+    }
+
+    size_t ChannelTable::size() const {
+        return this->m_configs.size();
+    }
+
+    /*
+     * Number of channels to request from ENet:
+     * the user channels plus the control channel.
+     */
+    size_t ChannelTable::enet_channel_count() const {
+        return this->m_configs.size() + 1;
+    }
+
+    /*
+     * ENet channel used for Snow's own messages (time sync,
+     * handshakes). Fixed, so both ends agree on it however
+     * many user channels they have.
+     */
+    uint8_t ChannelTable::control_channel() const {
+        return _CHANNEL_CONTROL;
+    }
+
+    /*
+     * ENet channel id a user channel is sent on.
+     */
+    uint8_t ChannelTable::enet_channel(uint8_t channel) const {
+        return (uint8_t)(channel + 1);
+    }
+
+    /*
+     * User channel id for a received ENet channel.
+     * Not valid for the control channel.
+     */
+    uint8_t ChannelTable::user_channel(uint8_t enet_channel) const {
+        return (uint8_t)(enet_channel - 1);
+    }
+
+    const ChannelConfig& ChannelTable::config(uint8_t channel) const {
+        return this->m_configs[channel];
+    }
+
+    const ChannelStats& ChannelTable::stats(uint8_t channel) const {
+        return this->m_stats[channel];
+    }
+
+    /*
+     * ENet packet flags matching the channel's delivery mode.
+     */
+    uint32_t ChannelTable::packet_flags(uint8_t channel) const {
+        switch (this->m_configs[channel].mode) {
+            case DeliveryMode::ReliableOrdered:
+                return ENET_PACKET_FLAG_RELIABLE;
+
+            case DeliveryMode::UnreliableUnsequenced:
+                return ENET_PACKET_FLAG_UNSEQUENCED | ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT;
+
+            case DeliveryMode::UnreliableSequenced:
+            case DeliveryMode::LatestOnly:
+            default:
+                return ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT;
+        }
+    }
+
+    /*
+     * Average time (ms) packets on this channel
+     * spent queued before being handed to ENet.
+     */
+    double ChannelTable::average_latency(uint8_t channel) const {
+        const ChannelStats& stats = this->m_stats[channel];
+        if (stats.latency_samples == 0) {
+            return 0.0;
+        }
+        return (double)stats.latency_total / (double)stats.latency_samples;
+    }
+
+    void ChannelTable::reset_stats() {
+        for (ChannelStats& stats : this->m_stats) {
+            stats = ChannelStats{};
+        }
+    }
+
+    void ChannelTable::record_send(uint8_t channel, size_t bytes, uint64_t latency) {
+        ChannelStats& stats = this->m_stats[channel];
+        stats.packets_sent++;
+        stats.bytes_sent += bytes;
+        stats.latency_total += latency;
+        stats.latency_samples++;
+        if (latency > stats.latency_max) {
+            stats.latency_max = latency;
+        }
+    }
+
+    void ChannelTable::record_receive(uint8_t channel, size_t bytes) {
+        ChannelStats& stats = this->m_stats[channel];
+        stats.packets_received++;
+        stats.bytes_received += bytes;
+    }
+
+    void ChannelTable::record_drop(uint8_t channel) {
+        this->m_stats[channel].packets_dropped++;
+    }
+}
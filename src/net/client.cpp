@@ -1,123 +1,411 @@
 #include <iostream>
 #include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
 
 #include "enet/enet.h"
 
 #include "net/client.h"
+#include "net/control.h"
+#include "net/context.h"
 #include "core/utils.h"
 
 namespace snow {
+    namespace {
+        // Time allowed to connect and receive a UUID (us)
+        constexpr uint64_t connect_timeout = 30ULL * 1000 * 1000;
+
+        // Lets the intercept callback find the Client that owns a host
+        std::mutex host_registry_mutex;
+        std::unordered_map<const ENetHost*, Client*> host_registry;
+    }
+
     Client::Client() {
         this->m_connection = nullptr;
         this->m_server = nullptr;
         this->m_uuid = Packet::default_uuid;
+        this->m_resume_secret = ResumeSecret{};
+        this->m_server_port = 0;
+        this->m_connect_mode = _CONNECT_NEW;
+        this->m_enet_acquired = false;
+        this->m_state = ConnectState::Disconnected;
+        this->m_connect_deadline = 0;
+        this->m_admission_reply = AdmissionReply::None;
+        this->m_admission_value = 0;
+        this->channels = ChannelTable::defaults();
+        this->m_next_time_sync = 0;
     }
 
     Client::~Client() {
+        if (this->m_server != nullptr) {
+            enet_peer_disconnect_now(this->m_server, _DISCONNECT_REASON_NONE);
+        }
+        if (this->m_connection != nullptr) {
+            std::lock_guard<std::mutex> lock(host_registry_mutex);
+            host_registry.erase(this->m_connection);
+        }
         enet_host_destroy(this->m_connection);
+
+        if (this->m_enet_acquired) {
+            Context::release_enet();
+        }
     }
 
+    /*
+     * Connect and wait for a UUID. Blocks for at most
+     * connect_timeout; returns false if the server didn't admit us.
+     */
     bool Client::connect_to_server(const char* ip, uint16_t port) {
-        if (enet_initialize() != 0) {
-            debug_error("Failed to initialize ENet.");
+        this->m_server_ip = ip;
+        this->m_server_port = port;
+        if (!this->begin_connect(_CONNECT_NEW)) {
             return false;
         }
 
         ENetEvent event;
+        while (this->m_state == ConnectState::Connecting || this->m_state == ConnectState::Handshaking) {
+            if (enet_host_service(this->m_connection, &event, 10) > 0) {
+                this->handle_connect_event(event);
+            }
+            this->update_connect();
+        }
+        return this->m_state == ConnectState::Connected;
+    }
+
+    /*
+     * Start connecting to the stored server address. Returns
+     * right away; handle_connect_event() moves the handshake along.
+     * With _CONNECT_RESUME the client asks to keep its current
+     * UUID (after a server handoff) when answering the challenge.
+     */
+    bool Client::begin_connect(uint32_t mode) {
+        this->m_connect_mode = mode;
         ENetAddress address;
         address.host = ENET_HOST_ANY;
-        address.port = port;
+        address.port = this->m_server_port;
 
         // Create local ENet host
-        this->m_connection = enet_host_create(
-            nullptr,        // Address
-            1,              // Peer count
-            0,              // Channel Limit
-            0,              // Incoming bandwidth
-            0               // Outgoing bandwidth
-        );
         if (this->m_connection == nullptr) {
-            debug_error("Failed to create local connection.");
-            return false;
+            if (!this->m_enet_acquired) {
+                if (!Context::acquire_enet()) {
+                    debug_error("Failed to initialize ENet.");
+                    return false;
+                }
+                this->m_enet_acquired = true;
+            }
+
+            this->m_connection = enet_host_create(
+                nullptr,        // Address
+                1,              // Peer count
+                0,              // Channel Limit
+                0,              // Incoming bandwidth
+                0               // Outgoing bandwidth
+            );
+            if (this->m_connection == nullptr) {
+                debug_error("Failed to create local connection.");
+                return false;
+            }
+
+            std::lock_guard<std::mutex> lock(host_registry_mutex);
+            host_registry[this->m_connection] = this;
+            this->m_connection->intercept = Client::intercept;
+            debug_log("[CLIENT] Host Created.");
         }
-        debug_log("[CLIENT] Host Created.");
 
         // Connect to server
-        enet_address_set_host(&address, ip);
+        enet_address_set_host(&address, this->m_server_ip.c_str());
         this->m_server = enet_host_connect(
             this->m_connection,                       // Host
             &address,                               // Server address
-            ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT,    // Channel count
-            0                                       // Data
+            this->channels.enet_channel_count(),    // Channel count
+            mode                                    // Data
         );
         if (this->m_server == nullptr) {
             debug_error("Failed to connect to server.");
             return false;
         }
-        debug_log("[CLIENT] Connection Established.");
 
-        // Listen for connect packet
-        bool connection_packet = false;
-        uint8_t connect_attempts = 0;
-        while (1) {
-            if (connect_attempts >= 6) {
+        this->m_state = ConnectState::Connecting;
+        this->m_connect_deadline = get_monotonic_time_us() + connect_timeout;
+        this->m_admission_reply = AdmissionReply::None;
+        debug_log("[CLIENT] Connecting...");
+        return true;
+    }
+
+    /*
+     * Events seen before the server has handed out a UUID.
+     * Nothing here reaches the user.
+     */
+    void Client::handle_connect_event(ENetEvent& event) {
+        switch (event.type)
+        {
+            case ENET_EVENT_TYPE_CONNECT:
+            {
+                if (this->m_state != ConnectState::Connecting) {
+                    break;
+                }
+                debug_log("[CLIENT] Connection packet received, waiting for UUID...");
+                this->m_state = ConnectState::Handshaking;
+
+                // Ask for the UUID we had before the handoff
+                if (this->m_connect_mode == _CONNECT_RESUME) {
+                    uint8_t request[_CONTROL_MAX_SIZE];
+                    PacketWriter writer(request, sizeof(request));
+                    writer.write_u8((uint8_t)ControlType::Resume);
+                    writer.write_uuid(this->m_uuid);
+                    writer.write_uuid(this->m_resume_secret);
+
+                    ENetPacket* packet = enet_packet_create(request, writer.size(), ENET_PACKET_FLAG_RELIABLE);
+                    if (packet == nullptr) {
+                        break;
+                    }
+                    if (enet_peer_send(this->m_server, this->channels.control_channel(), packet) < 0) {
+                        enet_packet_destroy(packet);
+                        break;
+                    }
+                    enet_host_flush(this->m_connection);
+                }
                 break;
             }
 
-            if ((enet_host_service(this->m_connection, &event, 5000) > 0)) {
-                connection_packet = true;
+            case ENET_EVENT_TYPE_RECEIVE:
+            {
+                // Time sync may already be running
+                if (event.channelID == this->channels.control_channel()) {
+                    handle_control_message(event, get_monotonic_time_us());
+                }
+                else if (this->m_state == ConnectState::Handshaking) {
+                    // Skip the stamp if the UUID came on a snapshot channel
+                    uint8_t channel = this->channels.user_channel(event.channelID);
+                    size_t stamp = (channel < this->channels.size() && this->channels.config(channel).snapshots)
+                        ? _SNAPSHOT_STAMP_SIZE
+                        : 0;
+
+                    // The UUID packet carries our resume secret
+                    PacketView view;
+                    if (event.packet->dataLength >= stamp
+                        && Packet::parse(event.packet->data + stamp, event.packet->dataLength - stamp, view)
+                        && view.size == sizeof(this->m_resume_secret.bytes)) {
+                        this->m_uuid = view.uuid;
+                        memcpy(this->m_resume_secret.bytes, view.data, view.size);
+                        this->m_state = ConnectState::Connected;
+                        debug_log("[CLIENT] UUID Received: %s", this->m_uuid.to_string().c_str());
+
+                        // Start clock synchronization right away
+                        this->m_time_sync.reset();
+                        this->m_next_time_sync = 0;
+                        this->update_time_sync();
+                        this->reset_snapshots();
+                    }
+                }
+                enet_packet_destroy(event.packet);
                 break;
             }
-        }
-        if (!connection_packet) {
-            debug_error("Connection failed: Did not receive connect packet");
-            enet_peer_reset(this->m_server);
-            return false;
-        }
-        debug_log("[CLIENT] Connection packet received.");
 
-        // Get UUID from server
-        debug_log("[CLIENT] Waiting for UUID...");
-        bool uuid_packet = false;
-        uint8_t uuid_attempts = 0;
-        while (1) {
-            if (uuid_attempts > 12) {
+            case ENET_EVENT_TYPE_DISCONNECT:
+            {
+                debug_error("Connection failed: Server closed the connection (%u).", event.data);
+                this->m_server = nullptr;
+                this->m_state = ConnectState::Disconnected;
+                break;
+            }
+
+            default:
+            {
                 break;
             }
+        }
+    }
+
+    /*
+     * Act on the server's admission reply, and give up on a
+     * connection attempt that has run out of time.
+     */
+    void Client::update_connect() {
+        if (this->m_state != ConnectState::Connecting && this->m_state != ConnectState::Handshaking) {
+            return;
+        }
 
-            if (enet_host_service(this->m_connection, &event, 5000) > 0) {
-                Packet packet(&event);
+        AdmissionReply reply = this->m_admission_reply;
+        this->m_admission_reply = AdmissionReply::None;
 
-                // Extra (probably useless) check to ensure
-                // we are looking at the correct packet.
-                if (packet.size == 0) {
-                    this->m_uuid = packet.uuid;
-                    uuid_packet = true;
-                    break;
-                }
+        // Connect again, this time carrying the cookie
+        if (reply == AdmissionReply::Cookie && this->m_state == ConnectState::Connecting) {
+            ENetAddress address = this->m_server->address;
+            enet_peer_reset(this->m_server);
+            this->m_server = enet_host_connect(
+                this->m_connection,
+                &address,
+                this->channels.enet_channel_count(),
+                this->m_admission_value
+            );
+            if (this->m_server == nullptr) {
+                debug_error("Failed to connect to server.");
+                this->m_state = ConnectState::Disconnected;
             }
+            return;
         }
-        if (!uuid_packet) {
-            debug_error("Connection failed: Did not receive UUID from server");
+
+        if (reply == AdmissionReply::Rejected && this->m_state == ConnectState::Connecting) {
+            debug_error("Connection failed: Rejected by server (%u).", this->m_admission_value);
             enet_peer_reset(this->m_server);
-            return false;
+            this->m_server = nullptr;
+            this->m_state = ConnectState::Disconnected;
+            return;
         }
 
-        debug_log("[CLIENT] UUID Received: %s", this->m_uuid.c_str());
+        if (get_monotonic_time_us() < this->m_connect_deadline) {
+            return;
+        }
 
-        return true;
+        if (this->m_state == ConnectState::Connecting) {
+            debug_error("Connection failed: Did not receive connect packet");
+        }
+        else {
+            debug_error("Connection failed: Did not receive UUID from server");
+        }
+        enet_peer_reset(this->m_server);
+        this->m_server = nullptr;
+        this->m_state = ConnectState::Disconnected;
+    }
+
+    /*
+     * ENet intercept callback. Picks the server's raw admission
+     * replies out of the incoming datagrams before ENet sees them.
+     */
+    int Client::intercept(ENetHost* host, ENetEvent*) {
+        if (host->receivedDataLength != _ADMISSION_REPLY_SIZE) {
+            return 0;
+        }
+
+        uint16_t marker = 0;
+        uint8_t type = 0;
+        uint32_t connect_id = 0;
+        uint32_t value = 0;
+
+        PacketReader reader(host->receivedData, host->receivedDataLength);
+        reader.read_u16(marker);
+        reader.read_u8(type);
+        reader.read_u32(connect_id);
+        reader.read_u32(value);
+        if (!reader.ok() || marker != _ADMISSION_MARKER) {
+            return 0;
+        }
+
+        Client* client = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(host_registry_mutex);
+            auto client_it = host_registry.find(host);
+            if (client_it != host_registry.end()) {
+                client = client_it->second;
+            }
+        }
+
+        // Only answers to the connect in flight count
+        ENetPeer* server = (client != nullptr) ? client->m_server : nullptr;
+        if (server == nullptr
+            || client->m_state != ConnectState::Connecting
+            || server->connectID != connect_id
+            || server->address.host != host->receivedAddress.host
+            || server->address.port != host->receivedAddress.port) {
+            return 1;
+        }
+
+        if (type == (uint8_t)AdmissionReply::Cookie || type == (uint8_t)AdmissionReply::Rejected) {
+            client->m_admission_reply = (AdmissionReply)type;
+            client->m_admission_value = value;
+        }
+        return 1;
     }
 
+    /*
+     * Disconnect gracefully, waiting up to timeout (ms)
+     * for the server to acknowledge.
+     */
+    void Client::disconnect(uint32_t timeout) {
+        if (this->m_server == nullptr) {
+            return;
+        }
+
+        enet_peer_disconnect(this->m_server, _DISCONNECT_REASON_NONE);
+        this->m_state = ConnectState::Disconnected;
+
+        ENetEvent event;
+        uint64_t deadline = get_local_timestamp() + timeout;
+        while (get_local_timestamp() < deadline) {
+            if (enet_host_service(this->m_connection, &event, 10) <= 0) {
+                continue;
+            }
+
+            if (event.type == ENET_EVENT_TYPE_RECEIVE) {
+                enet_packet_destroy(event.packet);
+            }
+            else if (event.type == ENET_EVENT_TYPE_DISCONNECT) {
+                this->m_server = nullptr;
+                return;
+            }
+        }
+
+        enet_peer_reset(this->m_server);
+        this->m_server = nullptr;
+    }
+
+    bool Client::is_connected() const {
+        return this->m_state == ConnectState::Connected;
+    }
+
+    /*
+     * True while a connection attempt is in progress,
+     * including the reconnect after a server handoff.
+     */
+    bool Client::is_connecting() const {
+        return this->m_state == ConnectState::Connecting || this->m_state == ConnectState::Handshaking;
+    }
+
+    /*
+     * Service the connection without blocking. Also advances a
+     * reconnect after a server handoff; user_callback only sees
+     * packets once the client is connected again.
+     */
     void Client::poll_events(std::function<void(ENetEvent&)> user_callback) {
         ENetEvent event;
 
+        if (this->m_connection == nullptr) {
+            return;
+        }
+
+        this->update_connect();
+        this->update_time_sync();
+
         while (enet_host_service(this->m_connection, &event, 0) > 0) {
+            if (this->m_state != ConnectState::Connected) {
+                this->handle_connect_event(event);
+                continue;
+            }
+
             switch (event.type)
             {
                 case ENET_EVENT_TYPE_RECEIVE:
                 {
                     if (event.packet->data == nullptr || event.packet->data == NULL) break;
 
+                    if (event.channelID == this->channels.control_channel()) {
+                        handle_control_message(event, get_monotonic_time_us());
+                        break;
+                    }
+
+                    // Users only ever see their own channel ids
+                    event.channelID = this->channels.user_channel(event.channelID);
+                    if (event.channelID < this->channels.size()) {
+                        this->channels.record_receive(event.channelID, event.packet->dataLength);
+
+                        if (this->channels.config(event.channelID).snapshots) {
+                            buffer_snapshot(event, event.channelID);
+                            break;
+                        }
+                    }
+
                     user_callback(event);
 
                     break;
@@ -125,11 +413,18 @@ namespace snow {
 
                 case ENET_EVENT_TYPE_DISCONNECT:
                 {
-                    // Destroy ENET objects and force exit
-                    enet_peer_reset(this->m_server);
-                    enet_host_destroy(this->m_connection);
-                    exit(EXIT_SUCCESS);
+                    this->m_server = nullptr;
+                    this->m_state = ConnectState::Disconnected;
 
+                    // The server moved to a new process on the same port
+                    if (event.data == _DISCONNECT_REASON_HANDOFF) {
+                        debug_log("[CLIENT] Server handoff, reconnecting...");
+                        if (this->begin_connect(_CONNECT_RESUME)) {
+                            break;
+                        }
+                    }
+
+                    debug_log("[CLIENT] Disconnected from server.");
                     break;
                 }
 
@@ -138,29 +433,234 @@ namespace snow {
                     break;
                 }
             }
+
+            if (event.type == ENET_EVENT_TYPE_RECEIVE) {
+                enet_packet_destroy(event.packet);
+            }
         }
     }
 
-    void Client::send_packet(const Packet& packet, bool reliable, uint8_t channel) {
-        size_t flag = 0;
+    /*
+     * Send a time sync request if one is due.
+     * Requests go out unsequenced and are flushed immediately
+     * so their send timestamp is accurate.
+     */
+    void Client::update_time_sync() {
+        if (this->m_state != ConnectState::Connected) {
+            return;
+        }
 
-        if (reliable) {
-            flag = ENET_PACKET_FLAG_RELIABLE;
+        // Same clock as the samples, so wall clock steps can't stall or flood requests
+        uint64_t now = get_monotonic_time_us();
+        if (now < this->m_next_time_sync) {
+            return;
         }
-        else {
-            flag = ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT;
+        this->m_next_time_sync = now + (uint64_t)this->m_time_sync.request_interval() * 1000;
+
+        ENetPacket* request = enet_packet_create(
+            nullptr, _CONTROL_MAX_SIZE, ENET_PACKET_FLAG_UNSEQUENCED
+        );
+        if (request == nullptr) {
+            return;
+        }
+
+        PacketWriter writer(request->data, request->dataLength);
+        writer.write_u8((uint8_t)ControlType::TimeSyncRequest);
+        writer.write_u64(now);
+        request->dataLength = writer.size();
+
+        if (enet_peer_send(this->m_server, this->channels.control_channel(), request) < 0) {
+            enet_packet_destroy(request);
+            return;
+        }
+        enet_host_flush(this->m_connection);
+    }
+
+    /*
+     * Handle a message on the internal control channel.
+     */
+    void Client::handle_control_message(ENetEvent& event, uint64_t received_at) {
+        PacketReader reader(event.packet->data, event.packet->dataLength);
+
+        uint8_t type = 0;
+        if (!reader.read_u8(type)) {
+            return;
+        }
+
+        switch ((ControlType)type)
+        {
+            case ControlType::TimeSyncResponse:
+            {
+                uint64_t client_send = 0;
+                uint64_t server_receive = 0;
+                uint64_t server_send = 0;
+                uint64_t tick = 0;
+                uint64_t tick_start = 0;
+                uint16_t tick_rate = 0;
+
+                reader.read_u64(client_send);
+                reader.read_u64(server_receive);
+                reader.read_u64(server_send);
+                reader.read_u64(tick);
+                reader.read_u64(tick_start);
+                reader.read_u16(tick_rate);
+                if (!reader.ok()) {
+                    debug_error("[CLIENT] Malformed time sync response.");
+                    return;
+                }
+
+                this->m_time_sync.add_sample(client_send, server_receive, server_send, received_at);
+                this->m_time_sync.set_tick_reference(tick, tick_start, tick_rate);
+
+                break;
+            }
+
+            default:
+            {
+                debug_error("[CLIENT] Unknown control message %u.", type);
+                break;
+            }
+        }
+    }
+
+    /*
+     * Start every snapshot channel over, e.g. after a
+     * reconnect, when the server's clock may have moved.
+     */
+    void Client::reset_snapshots() {
+        for (uint8_t channel = 0; channel < this->channels.size(); channel++) {
+            if (this->channels.config(channel).snapshots) {
+                this->m_snapshots[channel].clear();
+            }
+        }
+    }
+
+    /*
+     * Strip the server's stamp from a packet on a snapshot channel
+     * and buffer it, timed by our estimate of the server clock.
+     */
+    void Client::buffer_snapshot(ENetEvent& event, uint8_t channel) {
+        uint64_t tick = 0;
+        uint64_t time = 0;
+        PacketReader reader(event.packet->data, event.packet->dataLength);
+        reader.read_u64(tick);
+        reader.read_u64(time);
+
+        PacketView view;
+        if (!reader.ok() || !Packet::parse(event.packet->data + _SNAPSHOT_STAMP_SIZE, reader.remaining(), view)) {
+            debug_error("[CLIENT] Malformed snapshot.");
+            return;
+        }
+
+        // Arrival delays mean nothing until the clocks agree
+        if (!this->m_time_sync.synchronized()) {
+            this->channels.record_drop(channel);
+            return;
+        }
+
+        this->m_snapshots[channel].push(time, Packet(view), this->server_time_now(), tick);
+    }
+
+    /*
+     * Send a packet using the channel's configured delivery mode.
+     */
+    void Client::send_packet(const Packet& packet, uint8_t channel) {
+        if (channel >= this->channels.size()) {
+            debug_error("[CLIENT] Channel %u does not exist.", channel);
+            return;
+        }
+        _send_packet_immediate(packet, this->channels.packet_flags(channel), channel);
+    }
+
+    /*
+     * Send a packet, overriding the channel's delivery mode.
+     */
+    void Client::send_packet(const Packet& packet, bool reliable, uint8_t channel) {
+        if (channel >= this->channels.size()) {
+            debug_error("[CLIENT] Channel %u does not exist.", channel);
+            return;
+        }
+        uint32_t flags = reliable ? ENET_PACKET_FLAG_RELIABLE : ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT;
+        _send_packet_immediate(packet, flags, channel);
+    }
+
+    void Client::_send_packet_immediate(const Packet& packet, uint32_t flags, uint8_t channel) {
+        if (this->m_state != ConnectState::Connected) {
+            debug_error("[CLIENT] Not connected.");
+            return;
         }
 
-        uint8_t* bytes = packet.serialize();
         size_t size = packet.get_size();
-        ENetPacket* enet_packet = enet_packet_create(bytes, size, flag);
+        ENetPacket* enet_packet = packet.create_enet_packet(flags);
+        if (enet_packet == nullptr) {
+            return;
+        }
 
-        enet_peer_send(this->m_server, channel, enet_packet);
+        if (enet_peer_send(this->m_server, this->channels.enet_channel(channel), enet_packet) < 0) {
+            enet_packet_destroy(enet_packet);
+            return;
+        }
 
-        free(bytes);
+        if (channel < this->channels.size()) {
+            this->channels.record_send(channel, size, 0);
+        }
     }
 
-    const std::string& Client::get_uuid() const {
+    const Uuid& Client::get_uuid() const {
         return this->m_uuid;
     }
+
+    /*
+     * True once enough time sync samples have arrived
+     * for the estimates below to be trusted.
+     */
+    bool Client::is_time_synchronized() const {
+        return this->m_time_sync.synchronized();
+    }
+
+    /*
+     * Estimated server clock (us), comparable with
+     * get_monotonic_time_us() on the server.
+     */
+    uint64_t Client::server_time_now() const {
+        return this->m_time_sync.server_time(get_monotonic_time_us());
+    }
+
+    /*
+     * Estimated fractional server tick right now.
+     */
+    double Client::estimated_server_tick() const {
+        return this->m_time_sync.server_tick(get_monotonic_time_us());
+    }
+
+    /*
+     * Best recent round trip time to the server (us).
+     */
+    uint64_t Client::get_rtt() const {
+        return this->m_time_sync.rtt();
+    }
+
+    /*
+     * Buffered snapshots for a snapshot channel, or nullptr if
+     * channel isn't one. Snapshots arrive through poll_events().
+     */
+    SnapshotBuffer* Client::get_snapshots(uint8_t channel) {
+        if (channel >= this->channels.size() || !this->channels.config(channel).snapshots) {
+            return nullptr;
+        }
+        return &this->m_snapshots[channel];
+    }
+
+    /*
+     * Snapshots to render right now on a snapshot channel: the pair
+     * bracketing the server time one render delay ago. The pointers
+     * in out stay valid until the next poll_events().
+     */
+    bool Client::sample_snapshots(uint8_t channel, SnapshotSample& out) {
+        SnapshotBuffer* snapshots = this->get_snapshots(channel);
+        if (snapshots == nullptr || !this->m_time_sync.synchronized()) {
+            return false;
+        }
+        return snapshots->sample(snapshots->render_time(this->server_time_now()), out);
+    }
 }
@@ -0,0 +1,205 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+
+#include "enet/enet.h"
+
+#include "net/context.h"
+#include "core/utils.h"
+
+namespace snow {
+    namespace {
+        std::mutex enet_mutex;
+        size_t enet_references = 0;
+    }
+
+    Context::Context(size_t thread_count) {
+        this->m_shutdown = false;
+
+        if (!acquire_enet()) {
+            debug_error("[CONTEXT] Failed to initialize ENet.");
+            exit(EXIT_FAILURE);
+        }
+
+        if (thread_count == 0) {
+            thread_count = std::max(1u, std::thread::hardware_concurrency());
+        }
+        for (size_t i = 0; i < thread_count; i++) {
+            this->m_workers.emplace_back(&Context::worker, this);
+        }
+    }
+
+    Context::~Context() {
+        this->shutdown();
+        release_enet();
+    }
+
+    /*
+     * Start ticking an initialized server on the pool.
+     * Stops ticking it when the server's stop() is called.
+     */
+    void Context::add_server(
+        Server& server,
+        std::function<void(Server&)> user_loop,
+        std::function<bool(Server&, ENetEvent&)> connect_callback,
+        std::function<void(Server&, ENetEvent&)> disconnect_callback
+    ) {
+        server.m_user_loop = user_loop;
+        server.m_user_connect_callback = connect_callback;
+        server.m_user_disconnect_callback = disconnect_callback;
+        server.m_running = true;
+
+        std::lock_guard<std::mutex> lock(this->m_mutex);
+        this->m_servers.push_back((ScheduledServer){
+            .server = &server,
+            .next_tick = get_local_timestamp(),
+            .busy = false,
+        });
+        this->m_wakeup.notify_all();
+    }
+
+    /*
+     * Stop ticking a server, waiting for its current tick to end.
+     * Afterwards the server belongs to the calling thread again.
+     */
+    void Context::remove_server(Server& server) {
+        std::unique_lock<std::mutex> lock(this->m_mutex);
+
+        while (1) {
+            auto it = std::find_if(this->m_servers.begin(), this->m_servers.end(),
+                [&server](const ScheduledServer& scheduled) { return scheduled.server == &server; });
+            if (it == this->m_servers.end()) {
+                return;
+            }
+            if (!it->busy) {
+                this->m_servers.erase(it);
+                return;
+            }
+            this->m_wakeup.wait(lock);
+        }
+    }
+
+    size_t Context::server_count() {
+        std::lock_guard<std::mutex> lock(this->m_mutex);
+        return this->m_servers.size();
+    }
+
+    /*
+     * Finish in-progress ticks and stop the worker threads.
+     * Servers still added are left as they are.
+     */
+    void Context::shutdown() {
+        {
+            std::lock_guard<std::mutex> lock(this->m_mutex);
+            this->m_shutdown = true;
+            this->m_wakeup.notify_all();
+        }
+
+        for (std::thread& worker : this->m_workers) {
+            if (worker.joinable()) {
+                worker.join();
+            }
+        }
+        this->m_workers.clear();
+    }
+
+    /*
+     * Take a reference on ENet's global state,
+     * initializing it on the first reference.
+     */
+    bool Context::acquire_enet() {
+        std::lock_guard<std::mutex> lock(enet_mutex);
+
+        if (enet_references == 0) {
+            if (enet_initialize() != 0) {
+                return false;
+            }
+
+            // ENet's clock starts lazily on first use; start it
+            // here rather than racing on it from several hosts
+            enet_time_get();
+        }
+        enet_references++;
+
+        return true;
+    }
+
+    void Context::release_enet() {
+        std::lock_guard<std::mutex> lock(enet_mutex);
+
+        if (enet_references == 0) {
+            debug_error("[CONTEXT] ENet released more often than acquired.");
+            return;
+        }
+
+        enet_references--;
+        if (enet_references == 0) {
+            enet_deinitialize();
+        }
+    }
+
+    /*
+     * References currently held on ENet; 0 when it is torn down.
+     */
+    size_t Context::enet_reference_count() {
+        std::lock_guard<std::mutex> lock(enet_mutex);
+        return enet_references;
+    }
+
+    /*
+     * Repeatedly tick whichever idle server is due first.
+     * A server is only ever marked busy by one worker, which
+     * is what confines each Server to one thread at a time.
+     */
+    void Context::worker() {
+        std::unique_lock<std::mutex> lock(this->m_mutex);
+
+        while (!this->m_shutdown) {
+            ScheduledServer* next = nullptr;
+            for (ScheduledServer& scheduled : this->m_servers) {
+                if (!scheduled.busy && (next == nullptr || scheduled.next_tick < next->next_tick)) {
+                    next = &scheduled;
+                }
+            }
+
+            if (next == nullptr) {
+                this->m_wakeup.wait(lock);
+                continue;
+            }
+
+            uint64_t now = get_local_timestamp();
+            if (next->next_tick > now) {
+                this->m_wakeup.wait_for(lock, std::chrono::milliseconds(next->next_tick - now));
+                continue;
+            }
+
+            Server* server = next->server;
+            next->busy = true;
+
+            lock.unlock();
+            server->tick();
+            lock.lock();
+
+            // The vector may have changed while unlocked
+            auto it = std::find_if(this->m_servers.begin(), this->m_servers.end(),
+                [server](const ScheduledServer& scheduled) { return scheduled.server == server; });
+
+            if (!server->m_running) {
+                this->m_servers.erase(it);
+            }
+            else {
+                const uint64_t tick_time = 1000 / server->tick_rate;
+                it->busy = false;
+                it->next_tick += tick_time;
+
+                now = get_local_timestamp();
+                if (it->next_tick < now) {
+                    debug_warn("[CONTEXT] Server ran %llu ms behind", (unsigned long long)(now - it->next_tick));
+                    it->next_tick = now;
+                }
+            }
+
+            this->m_wakeup.notify_all();
+        }
+    }
+}
@@ -0,0 +1,320 @@
+#ifndef _WIN32
+    #include <poll.h>
+    #include <sys/socket.h>
+    #include <sys/un.h>
+    #include <unistd.h>
+#endif
+#include <cerrno>
+#include <cstring>
+
+#include "net/handoff.h"
+#include "net/packet_io.h"
+#include "core/utils.h"
+
+namespace snow {
+    namespace {
+        constexpr uint32_t handoff_magic = 0x534E4F57; // "SNOW"
+        constexpr uint8_t handoff_version = 2;
+
+        // magic, version, payload size
+        constexpr size_t header_size = 4 + 1 + 4;
+
+        // uuid, resume secret, host, port
+        constexpr size_t client_size = _UUID_SIZE + sizeof(ResumeSecret) + 4 + 2;
+    }
+
+#ifndef _WIN32
+    namespace {
+        bool make_address(const char* path, sockaddr_un& address) {
+            memset(&address, 0, sizeof(address));
+            address.sun_family = AF_UNIX;
+            if (strlen(path) >= sizeof(address.sun_path)) {
+                debug_error("[HANDOFF] Socket path too long.");
+                return false;
+            }
+            strcpy(address.sun_path, path);
+            return true;
+        }
+
+        bool wait_for(int fd, short events, uint32_t timeout) {
+            pollfd descriptor = {};
+            descriptor.fd = fd;
+            descriptor.events = events;
+            return poll(&descriptor, 1, (int)timeout) > 0;
+        }
+
+        bool write_all(int fd, const uint8_t* data, size_t size) {
+            while (size > 0) {
+                ssize_t written = write(fd, data, size);
+                if (written < 0) {
+                    if (errno == EINTR) continue;
+                    return false;
+                }
+                data += written;
+                size -= (size_t)written;
+            }
+            return true;
+        }
+
+        bool read_all(int fd, uint8_t* data, size_t size, uint32_t timeout) {
+            while (size > 0) {
+                if (!wait_for(fd, POLLIN, timeout)) {
+                    return false;
+                }
+
+                ssize_t received = read(fd, data, size);
+                if (received < 0) {
+                    if (errno == EINTR) continue;
+                    return false;
+                }
+                if (received == 0) {
+                    return false;
+                }
+                data += received;
+                size -= (size_t)received;
+            }
+            return true;
+        }
+    }
+
+    /*
+     * Sends the header together with the UDP socket (SCM_RIGHTS),
+     * then the client table and user state.
+     */
+    bool write_handoff(int fd, const HandoffState& state) {
+        size_t payload_size = 4 + state.clients.size() * client_size + 4 + state.user_state.size();
+        if (payload_size > _HANDOFF_MAX_SIZE) {
+            debug_error("[HANDOFF] State too large to hand off.");
+            return false;
+        }
+
+        std::vector<uint8_t> payload(payload_size);
+        PacketWriter writer(payload.data(), payload.size());
+        writer.write_u32((uint32_t)state.clients.size());
+        for (const HandoffClient& client : state.clients) {
+            writer.write_uuid(client.uuid);
+            writer.write_uuid(client.secret);
+            writer.write_bytes(&client.address.host, 4);
+            writer.write_u16(client.address.port);
+        }
+        writer.write_u32((uint32_t)state.user_state.size());
+        writer.write_bytes(state.user_state.data(), state.user_state.size());
+        if (!writer.ok()) {
+            return false;
+        }
+
+        uint8_t header[header_size];
+        PacketWriter header_writer(header, sizeof(header));
+        header_writer.write_u32(handoff_magic);
+        header_writer.write_u8(handoff_version);
+        header_writer.write_u32((uint32_t)payload_size);
+
+        iovec vector;
+        vector.iov_base = header;
+        vector.iov_len = sizeof(header);
+
+        union {
+            char buffer[CMSG_SPACE(sizeof(int))];
+            cmsghdr align;
+        } control;
+        memset(&control, 0, sizeof(control));
+
+        msghdr message = {};
+        message.msg_iov = &vector;
+        message.msg_iovlen = 1;
+        message.msg_control = control.buffer;
+        message.msg_controllen = sizeof(control.buffer);
+
+        cmsghdr* control_message = CMSG_FIRSTHDR(&message);
+        control_message->cmsg_level = SOL_SOCKET;
+        control_message->cmsg_type = SCM_RIGHTS;
+        control_message->cmsg_len = CMSG_LEN(sizeof(int));
+        int socket_fd = (int)state.socket;
+        memcpy(CMSG_DATA(control_message), &socket_fd, sizeof(int));
+
+        return sendmsg(fd, &message, 0) == (ssize_t)sizeof(header)
+            && write_all(fd, payload.data(), payload.size());
+    }
+
+    /*
+     * Counterpart of write_handoff(). On success state.socket
+     * is a new descriptor for the old process's UDP socket.
+     */
+    bool read_handoff(int fd, HandoffState& state, uint32_t timeout) {
+        uint8_t header[header_size];
+        iovec vector;
+        vector.iov_base = header;
+        vector.iov_len = sizeof(header);
+
+        union {
+            char buffer[CMSG_SPACE(sizeof(int))];
+            cmsghdr align;
+        } control;
+        memset(&control, 0, sizeof(control));
+
+        msghdr message = {};
+        message.msg_iov = &vector;
+        message.msg_iovlen = 1;
+        message.msg_control = control.buffer;
+        message.msg_controllen = sizeof(control.buffer);
+
+        int socket_fd = -1;
+        bool valid = wait_for(fd, POLLIN, timeout)
+            && recvmsg(fd, &message, MSG_WAITALL) == (ssize_t)sizeof(header);
+
+        cmsghdr* control_message = valid ? CMSG_FIRSTHDR(&message) : nullptr;
+        if (control_message != nullptr
+            && control_message->cmsg_level == SOL_SOCKET
+            && control_message->cmsg_type == SCM_RIGHTS) {
+            memcpy(&socket_fd, CMSG_DATA(control_message), sizeof(int));
+        }
+
+        uint32_t magic = 0;
+        uint8_t version = 0;
+        uint32_t payload_size = 0;
+        PacketReader header_reader(header, sizeof(header));
+        header_reader.read_u32(magic);
+        header_reader.read_u8(version);
+        header_reader.read_u32(payload_size);
+
+        valid = valid && socket_fd >= 0
+            && magic == handoff_magic
+            && version == handoff_version
+            && payload_size <= _HANDOFF_MAX_SIZE;
+
+        std::vector<uint8_t> payload;
+        if (valid) {
+            payload.resize(payload_size);
+            valid = read_all(fd, payload.data(), payload.size(), timeout);
+        }
+
+        // Parse the client table
+        PacketReader reader(payload.data(), payload.size());
+        uint32_t client_count = 0;
+        if (valid) {
+            valid = reader.read_u32(client_count)
+                && client_count <= reader.remaining() / client_size;
+        }
+
+        state.clients.clear();
+        for (uint32_t i = 0; valid && i < client_count; i++) {
+            HandoffClient client;
+            reader.read_uuid(client.uuid);
+            reader.read_uuid(client.secret);
+            reader.read_bytes(&client.address.host, 4);
+            reader.read_u16(client.address.port);
+            state.clients.push_back(client);
+        }
+
+        uint32_t user_size = 0;
+        if (valid) {
+            valid = reader.read_u32(user_size) && user_size == reader.remaining();
+        }
+        if (valid) {
+            state.user_state.resize(user_size);
+            valid = reader.read_bytes(state.user_state.data(), user_size);
+        }
+
+        if (!valid) {
+            debug_error("[HANDOFF] Malformed handoff message.");
+            if (socket_fd >= 0) {
+                close(socket_fd);
+            }
+            return false;
+        }
+
+        state.socket = (ENetSocket)socket_fd;
+        return true;
+    }
+
+    /*
+     * Connect to the replacement listening on path and write_handoff().
+     */
+    bool send_handoff(const char* path, const HandoffState& state, uint32_t timeout) {
+        sockaddr_un address;
+        if (!make_address(path, address)) {
+            return false;
+        }
+
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            debug_error("[HANDOFF] Failed to create unix socket.");
+            return false;
+        }
+
+        // The replacement may still be starting up
+        uint64_t deadline = get_local_timestamp() + timeout;
+        while (connect(fd, (sockaddr*)&address, sizeof(address)) < 0) {
+            if (get_local_timestamp() >= deadline) {
+                debug_error("[HANDOFF] Nobody listening on %s.", path);
+                close(fd);
+                return false;
+            }
+            usleep(10000);
+        }
+
+        bool sent = write_handoff(fd, state);
+        close(fd);
+        return sent;
+    }
+
+    /*
+     * Listen on path for the old process and read_handoff().
+     */
+    bool receive_handoff(const char* path, HandoffState& state, uint32_t timeout) {
+        sockaddr_un address;
+        if (!make_address(path, address)) {
+            return false;
+        }
+
+        int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listener < 0) {
+            debug_error("[HANDOFF] Failed to create unix socket.");
+            return false;
+        }
+
+        unlink(path);
+        if (bind(listener, (sockaddr*)&address, sizeof(address)) < 0 || listen(listener, 1) < 0) {
+            debug_error("[HANDOFF] Failed to listen on %s.", path);
+            close(listener);
+            return false;
+        }
+
+        int fd = -1;
+        if (wait_for(listener, POLLIN, timeout)) {
+            fd = accept(listener, nullptr, nullptr);
+        }
+        close(listener);
+        unlink(path);
+
+        if (fd < 0) {
+            debug_error("[HANDOFF] No handoff received.");
+            return false;
+        }
+
+        bool received = read_handoff(fd, state, timeout);
+        close(fd);
+        return received;
+    }
+#else
+    bool write_handoff(int, const HandoffState&) {
+        debug_error("[HANDOFF] Socket handoff is not supported on this platform.");
+        return false;
+    }
+
+    bool read_handoff(int, HandoffState&, uint32_t) {
+        debug_error("[HANDOFF] Socket handoff is not supported on this platform.");
+        return false;
+    }
+
+    bool send_handoff(const char*, const HandoffState&, uint32_t) {
+        debug_error("[HANDOFF] Socket handoff is not supported on this platform.");
+        return false;
+    }
+
+    bool receive_handoff(const char*, HandoffState&, uint32_t) {
+        debug_error("[HANDOFF] Socket handoff is not supported on this platform.");
+        return false;
+    }
+#endif
+}
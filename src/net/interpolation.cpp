@@ -0,0 +1,209 @@
+#include <algorithm>
+#include <utility>
+
+#include "net/interpolation.h"
+
+namespace snow {
+    namespace {
+        // Arrival delays kept for the percentile
+        constexpr size_t delay_window = 64;
+
+        // How fast the render delay follows its target. Growing fast
+        // avoids extrapolating; shrinking slowly avoids visible time warps.
+        constexpr double grow_rate = 0.25;
+        constexpr double shrink_rate = 0.02;
+
+        // Weight of each new gap in the snapshot interval average
+        constexpr double interval_rate = 0.1;
+    }
+
+    SnapshotBuffer::SnapshotBuffer(size_t capacity) {
+        this->percentile = 0.95f;
+        this->min_delay = 0;
+
+        this->m_snapshots.resize(std::max<size_t>(capacity, 2));
+        this->m_delays.resize(delay_window);
+        this->clear();
+    }
+
+    void SnapshotBuffer::clear() {
+        this->m_start = 0;
+        this->m_count = 0;
+        this->m_next_delay = 0;
+        this->m_delay_count = 0;
+        this->m_interval = 0.0;
+        this->m_render_delay = 0.0;
+        this->m_samples = 0;
+        this->m_extrapolated = 0;
+    }
+
+    /*
+     * Snapshot at position index, oldest first.
+     */
+    Snapshot& SnapshotBuffer::at(size_t index) {
+        return this->m_snapshots[(this->m_start + index) % this->m_snapshots.size()];
+    }
+
+    /*
+     * Add a snapshot. Late snapshots are slotted into place;
+     * duplicates and ones older than the whole buffer are dropped.
+     * Invalidates every SnapshotSample taken before.
+     */
+    void SnapshotBuffer::push(uint64_t time, const Packet& packet, uint64_t arrival, uint64_t tick) {
+        // Delay is recorded even for late snapshots; they are jitter too
+        this->m_delays[this->m_next_delay] = (int64_t)arrival - (int64_t)time;
+        this->m_next_delay = (this->m_next_delay + 1) % delay_window;
+        this->m_delay_count = std::min(this->m_delay_count + 1, delay_window);
+
+        if (this->m_count > 0) {
+            uint64_t newest = this->at(this->m_count - 1).time;
+            if (time > newest) {
+                double gap = (double)(time - newest);
+                if (this->m_interval == 0.0) {
+                    this->m_interval = gap;
+                }
+                else {
+                    this->m_interval += (gap - this->m_interval) * interval_rate;
+                }
+            }
+        }
+
+        for (size_t i = 0; i < this->m_count; i++) {
+            if (this->at(i).time == time) {
+                return;
+            }
+        }
+
+        // Full: overwrite the oldest, unless this one is older still
+        size_t capacity = this->m_snapshots.size();
+        if (this->m_count == capacity) {
+            if (time <= this->at(0).time) {
+                return;
+            }
+            this->m_start = (this->m_start + 1) % capacity;
+            this->m_count--;
+        }
+
+        // Append, then bubble back into time order
+        size_t index = this->m_count;
+        Snapshot& slot = this->at(index);
+        slot.tick = tick;
+        slot.time = time;
+        slot.arrival = arrival;
+        slot.packet = packet;
+        this->m_count++;
+
+        while (index > 0 && this->at(index - 1).time > this->at(index).time) {
+            std::swap(this->at(index - 1), this->at(index));
+            index--;
+        }
+
+        this->update_delay();
+    }
+
+    /*
+     * Move the render delay towards one interval plus the
+     * configured percentile of recent arrival delays.
+     */
+    void SnapshotBuffer::update_delay() {
+        if (this->m_delay_count == 0) {
+            return;
+        }
+
+        int64_t delays[delay_window];
+        std::copy(this->m_delays.begin(), this->m_delays.begin() + this->m_delay_count, delays);
+
+        float clamped = std::min(std::max(this->percentile, 0.0f), 1.0f);
+        size_t rank = (size_t)(clamped * (float)(this->m_delay_count - 1));
+        std::nth_element(delays, delays + rank, delays + this->m_delay_count);
+
+        double target = this->m_interval + (double)std::max<int64_t>(delays[rank], 0);
+        target = std::max(target, (double)this->min_delay);
+
+        if (this->m_render_delay == 0.0) {
+            this->m_render_delay = target;
+        }
+        else if (target > this->m_render_delay) {
+            this->m_render_delay += (target - this->m_render_delay) * grow_rate;
+        }
+        else {
+            this->m_render_delay += (target - this->m_render_delay) * shrink_rate;
+        }
+    }
+
+    /*
+     * Server time to render at.
+     */
+    uint64_t SnapshotBuffer::render_time(uint64_t server_now) {
+        uint64_t delay = (uint64_t)this->m_render_delay;
+        return (server_now > delay) ? server_now - delay : 0;
+    }
+
+    /*
+     * Find the two snapshots bracketing render_time.
+     * Past the newest snapshot the last two are extrapolated;
+     * before the oldest, the oldest is returned as-is.
+     * Returns false when the buffer is empty.
+     */
+    bool SnapshotBuffer::sample(uint64_t render_time, SnapshotSample& out) {
+        if (this->m_count == 0) {
+            return false;
+        }
+
+        this->m_samples++;
+        out.extrapolating = false;
+
+        if (this->m_count == 1 || render_time <= this->at(0).time) {
+            out.from = &this->at(0);
+            out.to = out.from;
+            out.alpha = 0.0f;
+            return true;
+        }
+
+        size_t upper = 1;
+        while (upper < this->m_count && this->at(upper).time < render_time) {
+            upper++;
+        }
+
+        if (upper == this->m_count) {
+            upper = this->m_count - 1;
+            out.extrapolating = (render_time > this->at(upper).time);
+            if (out.extrapolating) {
+                this->m_extrapolated++;
+            }
+        }
+
+        const Snapshot& from = this->at(upper - 1);
+        const Snapshot& to = this->at(upper);
+        out.from = &from;
+        out.to = &to;
+        out.alpha = (float)((double)((int64_t)render_time - (int64_t)from.time) / (double)(to.time - from.time));
+
+        return true;
+    }
+
+    size_t SnapshotBuffer::size() const {
+        return this->m_count;
+    }
+
+    uint64_t SnapshotBuffer::get_render_delay() const {
+        return (uint64_t)this->m_render_delay;
+    }
+
+    /*
+     * Average time between consecutive snapshots (us).
+     */
+    uint64_t SnapshotBuffer::get_interval() const {
+        return (uint64_t)this->m_interval;
+    }
+
+    /*
+     * Fraction of sample() calls that had to extrapolate.
+     */
+    double SnapshotBuffer::get_extrapolation_rate() const {
+        if (this->m_samples == 0) {
+            return 0.0;
+        }
+        return (double)this->m_extrapolated / (double)this->m_samples;
+    }
+}
@@ -0,0 +1,399 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "enet/enet.h"
+
+#include "net/link_simulator.h"
+#include "core/utils.h"
+
+namespace snow {
+    namespace {
+        // Largest datagram ENet will produce
+        constexpr size_t max_datagram_size = 4096;
+
+        // Routes with no traffic for this long are torn down (us)
+        constexpr uint64_t route_idle_timeout = 60ULL * 1000 * 1000;
+
+        uint64_t address_key(const ENetAddress& address) {
+            return ((uint64_t)address.host << 16) | address.port;
+        }
+
+        /*
+         * splitmix64 step; small, fast and identical on every
+         * platform, unlike the std:: distributions.
+         */
+        uint64_t next_random(uint64_t& state) {
+            uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            return z ^ (z >> 31);
+        }
+
+        // Uniform in [0, 1)
+        double next_unit(uint64_t& state) {
+            return (double)(next_random(state) >> 11) * (1.0 / 9007199254740992.0);
+        }
+
+        bool chance(uint64_t& state, float probability) {
+            if (probability <= 0.0f) return false;
+            return next_unit(state) < probability;
+        }
+
+        /*
+         * Random extra delay in microseconds.
+         */
+        uint64_t jitter_delay(uint64_t& state, const LinkConditions& conditions) {
+            if (conditions.jitter == 0) {
+                return 0;
+            }
+
+            double jitter = (double)conditions.jitter * 1000.0;
+            if (conditions.distribution == JitterDistribution::Normal) {
+                // Box-Muller
+                double u1 = 1.0 - next_unit(state);
+                double u2 = next_unit(state);
+                double z = std::sqrt(-2.0 * std::log(u1)) * std::cos(6.283185307179586 * u2);
+                return (uint64_t)(std::fabs(z) * jitter);
+            }
+            return (uint64_t)(next_unit(state) * jitter);
+        }
+    }
+
+    LinkSimulator::LinkSimulator(uint16_t port, const char* server_ip, uint16_t server_port, uint64_t seed) {
+        this->m_port = port;
+        this->m_socket = ENET_SOCKET_NULL;
+        this->m_seed = seed;
+        this->m_routes_created = 0;
+        this->m_sequence = 0;
+        this->m_running = false;
+        this->m_stats = LinkStats{};
+        this->m_default_upstream = LinkConditions{};
+        this->m_default_downstream = LinkConditions{};
+
+        this->m_server_address.host = ENET_HOST_ANY;
+        this->m_server_address.port = server_port;
+        enet_address_set_host(&this->m_server_address, server_ip);
+    }
+
+    LinkSimulator::~LinkSimulator() {
+        for (auto& entry : this->m_routes) {
+            enet_socket_destroy(entry.second.socket);
+        }
+        this->m_routes.clear();
+
+        if (this->m_socket != ENET_SOCKET_NULL) {
+            enet_socket_destroy(this->m_socket);
+            this->m_socket = ENET_SOCKET_NULL;
+        }
+    }
+
+    /*
+     * Bind the client-facing socket.
+     * ENet must already be initialized.
+     */
+    bool LinkSimulator::init() {
+        this->m_socket = enet_socket_create(ENET_SOCKET_TYPE_DATAGRAM);
+        if (this->m_socket == ENET_SOCKET_NULL) {
+            debug_error("[LINK] Failed to create socket.");
+            return false;
+        }
+        enet_socket_set_option(this->m_socket, ENET_SOCKOPT_NONBLOCK, 1);
+
+        ENetAddress address;
+        address.host = ENET_HOST_ANY;
+        address.port = this->m_port;
+        if (enet_socket_bind(this->m_socket, &address) < 0) {
+            debug_error("[LINK] Failed to bind port %u.", this->m_port);
+            enet_socket_destroy(this->m_socket);
+            this->m_socket = ENET_SOCKET_NULL;
+            return false;
+        }
+
+        return true;
+    }
+
+    /*
+     * Conditions for clients without their own override.
+     * Only applies to routes created afterwards.
+     */
+    void LinkSimulator::set_default_conditions(const LinkConditions& upstream, const LinkConditions& downstream) {
+        this->m_default_upstream = upstream;
+        this->m_default_downstream = downstream;
+    }
+
+    /*
+     * Per-client conditions, keyed by the client's source address.
+     * Takes effect immediately if the client is already routed.
+     */
+    void LinkSimulator::set_conditions(const ENetAddress& client, const LinkConditions& upstream, const LinkConditions& downstream) {
+        uint64_t key = address_key(client);
+        this->m_overrides[key] = std::make_pair(upstream, downstream);
+
+        auto route_it = this->m_routes.find(key);
+        if (route_it != this->m_routes.end()) {
+            route_it->second.upstream.conditions = upstream;
+            route_it->second.downstream.conditions = downstream;
+        }
+    }
+
+    /*
+     * Move traffic in both directions and release due packets.
+     * Blocks for at most timeout milliseconds.
+     */
+    void LinkSimulator::service(uint32_t timeout) {
+        if (this->m_socket == ENET_SOCKET_NULL) {
+            return;
+        }
+
+        uint64_t now = get_monotonic_time_us();
+        receive_upstream(now);
+        receive_downstream(now);
+        deliver(now);
+        expire_routes(now);
+
+        // Sleep until the next delivery, new traffic or the timeout.
+        // Downstream sockets are only polled between waits, so cap at 1 ms.
+        uint32_t wait = std::min<uint32_t>(timeout, 1);
+        if (!this->m_in_flight.empty()) {
+            uint64_t next = this->m_in_flight.begin()->first.first;
+            if (next <= now) {
+                wait = 0;
+            }
+        }
+
+        if (wait > 0) {
+            uint32_t condition = ENET_SOCKET_WAIT_RECEIVE;
+            enet_socket_wait(this->m_socket, &condition, wait);
+        }
+    }
+
+    /*
+     * Pump the simulator until stop() is called.
+     */
+    void LinkSimulator::run() {
+        this->m_running = true;
+        while (this->m_running) {
+            service(1);
+        }
+    }
+
+    void LinkSimulator::stop() {
+        this->m_running = false;
+    }
+
+    const LinkStats& LinkSimulator::get_stats() const {
+        return this->m_stats;
+    }
+
+    /*
+     * Find or create the route for a client address.
+     */
+    LinkSimulator::LinkRoute* LinkSimulator::get_route(const ENetAddress& client, uint64_t now) {
+        uint64_t key = address_key(client);
+
+        auto route_it = this->m_routes.find(key);
+        if (route_it != this->m_routes.end()) {
+            route_it->second.last_active = now;
+            return &route_it->second;
+        }
+
+        ENetSocket socket = enet_socket_create(ENET_SOCKET_TYPE_DATAGRAM);
+        if (socket == ENET_SOCKET_NULL) {
+            debug_error("[LINK] Failed to create route socket.");
+            return nullptr;
+        }
+        enet_socket_set_option(socket, ENET_SOCKOPT_NONBLOCK, 1);
+
+        ENetAddress local;
+        local.host = ENET_HOST_ANY;
+        local.port = 0;
+        if (enet_socket_bind(socket, &local) < 0) {
+            debug_error("[LINK] Failed to bind route socket.");
+            enet_socket_destroy(socket);
+            return nullptr;
+        }
+
+        LinkRoute route = {};
+        route.client = client;
+        route.socket = socket;
+        route.last_active = now;
+        route.random_state = this->m_seed ^ (++this->m_routes_created * 0xD1B54A32D192ED03ULL);
+        route.upstream.conditions = this->m_default_upstream;
+        route.downstream.conditions = this->m_default_downstream;
+
+        auto override_it = this->m_overrides.find(key);
+        if (override_it != this->m_overrides.end()) {
+            route.upstream.conditions = override_it->second.first;
+            route.downstream.conditions = override_it->second.second;
+        }
+
+        debug_log("[LINK] New route for client port %u.", client.port);
+        return &this->m_routes.emplace(key, route).first->second;
+    }
+
+    /*
+     * Client to server traffic.
+     */
+    void LinkSimulator::receive_upstream(uint64_t now) {
+        uint8_t data[max_datagram_size];
+
+        while (1) {
+            ENetAddress sender;
+            ENetBuffer buffer;
+            buffer.data = data;
+            buffer.dataLength = sizeof(data);
+
+            int received = enet_socket_receive(this->m_socket, &sender, &buffer, 1);
+            if (received <= 0) {
+                break;
+            }
+
+            LinkRoute* route = get_route(sender, now);
+            if (route == nullptr) {
+                continue;
+            }
+            impair(*route, true, data, (size_t)received, now);
+        }
+    }
+
+    /*
+     * Server to client traffic.
+     */
+    void LinkSimulator::receive_downstream(uint64_t now) {
+        uint8_t data[max_datagram_size];
+
+        for (auto& entry : this->m_routes) {
+            LinkRoute& route = entry.second;
+
+            while (1) {
+                ENetAddress sender;
+                ENetBuffer buffer;
+                buffer.data = data;
+                buffer.dataLength = sizeof(data);
+
+                int received = enet_socket_receive(route.socket, &sender, &buffer, 1);
+                if (received <= 0) {
+                    break;
+                }
+
+                route.last_active = now;
+                impair(route, false, data, (size_t)received, now);
+            }
+        }
+    }
+
+    /*
+     * Decide the fate of one datagram: drop it, or schedule
+     * one or two copies for delivery.
+     */
+    void LinkSimulator::impair(LinkRoute& route, bool upstream, const uint8_t* data, size_t size, uint64_t now) {
+        LinkDirection& direction = upstream ? route.upstream : route.downstream;
+        const LinkConditions& conditions = direction.conditions;
+        uint64_t& random = route.random_state;
+
+        // Gilbert-Elliott burst loss
+        if (direction.in_burst) {
+            if (chance(random, conditions.burst_exit)) {
+                direction.in_burst = false;
+            }
+        }
+        else if (chance(random, conditions.burst_enter)) {
+            direction.in_burst = true;
+        }
+
+        float loss = direction.in_burst ? conditions.burst_loss : conditions.loss;
+        if (chance(random, loss)) {
+            this->m_stats.packets_dropped++;
+            return;
+        }
+
+        // Serialization delay on a bandwidth-limited link. Only bytes
+        // the link has yet to send count against the queue; packets
+        // already on the wire are just waiting out their latency.
+        uint64_t send_at = now;
+        if (conditions.bandwidth > 0) {
+            uint64_t start = std::max(now, direction.link_free_at);
+            uint64_t backlog = (start - now) * conditions.bandwidth / 1000000;
+            if (conditions.queue_limit > 0 && backlog + size > conditions.queue_limit) {
+                this->m_stats.packets_dropped++;
+                return;
+            }
+
+            direction.link_free_at = start + (uint64_t)size * 1000000 / conditions.bandwidth;
+            send_at = direction.link_free_at;
+        }
+
+        int copies = 1;
+        if (chance(random, conditions.duplicate)) {
+            copies = 2;
+            this->m_stats.packets_duplicated++;
+        }
+
+        for (int i = 0; i < copies; i++) {
+            uint64_t delay = (uint64_t)conditions.latency * 1000 + jitter_delay(random, conditions);
+            if (chance(random, conditions.reorder)) {
+                delay += (uint64_t)conditions.reorder_delay * 1000;
+                this->m_stats.packets_reordered++;
+            }
+
+            DelayedPacket packet;
+            packet.route = address_key(route.client);
+            packet.upstream = upstream;
+            packet.data.assign(data, data + size);
+
+            this->m_in_flight.emplace(
+                std::make_pair(send_at + delay, this->m_sequence++),
+                std::move(packet)
+            );
+        }
+    }
+
+    /*
+     * Send every packet whose delivery time has passed.
+     */
+    void LinkSimulator::deliver(uint64_t now) {
+        while (!this->m_in_flight.empty()) {
+            auto packet_it = this->m_in_flight.begin();
+            if (packet_it->first.first > now) {
+                break;
+            }
+
+            DelayedPacket& packet = packet_it->second;
+            auto route_it = this->m_routes.find(packet.route);
+
+            if (route_it != this->m_routes.end()) {
+                LinkRoute& route = route_it->second;
+
+                ENetBuffer buffer;
+                buffer.data = packet.data.data();
+                buffer.dataLength = packet.data.size();
+
+                if (packet.upstream) {
+                    enet_socket_send(route.socket, &this->m_server_address, &buffer, 1);
+                }
+                else {
+                    enet_socket_send(this->m_socket, &route.client, &buffer, 1);
+                }
+
+                this->m_stats.packets_forwarded++;
+                this->m_stats.bytes_forwarded += packet.data.size();
+            }
+
+            this->m_in_flight.erase(packet_it);
+        }
+    }
+
+    void LinkSimulator::expire_routes(uint64_t now) {
+        auto route_it = this->m_routes.begin();
+        while (route_it != this->m_routes.end()) {
+            if (now - route_it->second.last_active > route_idle_timeout) {
+                enet_socket_destroy(route_it->second.socket);
+                route_it = this->m_routes.erase(route_it);
+            }
+            else {
+                route_it++;
+            }
+        }
+    }
+}
@@ -14,7 +14,7 @@ namespace snow {
      * Data buffer is nullptr.
      */
     Packet::Packet() {
-        strcpy(this->uuid, Packet::default_uuid);
+        this->uuid = Packet::default_uuid;
         this->size = 0;
         this->data = nullptr;
     }
@@ -24,11 +24,14 @@ namespace snow {
      * Copies the underlying data buffer.
      */
     Packet::Packet(const Packet& packet) {
-        strcpy(this->uuid, packet.uuid);
+        this->uuid = packet.uuid;
         this->size = packet.size;
 
-        this->data = std::make_unique<uint8_t[]>(this->size);
-        memcpy(this->data.get(), packet.data.get(), this->size);
+        this->data = nullptr;
+        if (packet.data != nullptr && this->size > 0) {
+            this->data = std::make_unique<uint8_t[]>(this->size);
+            memcpy(this->data.get(), packet.data.get(), this->size);
+        }
     }
 
     /*
@@ -36,7 +39,7 @@ namespace snow {
      * Takes ownership of the underlying data buffer.
      */
     Packet::Packet(Packet&& packet) noexcept {
-        strcpy(this->uuid, packet.uuid);
+        this->uuid = packet.uuid;
         this->size = packet.size;
         this->data = std::move(packet.data);
     }
@@ -47,11 +50,14 @@ namespace snow {
      */
     Packet& Packet::operator=(const Packet& packet) {
         if (this != &packet) {
-            strcpy(this->uuid, packet.uuid);
+            this->uuid = packet.uuid;
             this->size = packet.size;
 
-            this->data = std::make_unique<uint8_t[]>(this->size);
-            memcpy(this->data.get(), packet.data.get(), this->size);
+            this->data = nullptr;
+            if (packet.data != nullptr && this->size > 0) {
+                this->data = std::make_unique<uint8_t[]>(this->size);
+                memcpy(this->data.get(), packet.data.get(), this->size);
+            }
         }
         return *this;
     }
@@ -62,7 +68,7 @@ namespace snow {
      */
     Packet& Packet::operator=(Packet&& packet) noexcept {
         if (this != &packet) {
-            strcpy(this->uuid, packet.uuid);
+            this->uuid = packet.uuid;
             this->size = packet.size;
 
             this->data = std::move(packet.data);
@@ -70,15 +76,33 @@ namespace snow {
         return *this;
     }
 
+    /*
+     * Construct packet from a parsed view.
+     * Copies the payload out of the received buffer.
+     */
+    Packet::Packet(const PacketView& view) {
+        this->uuid = view.uuid;
+        this->size = view.size;
+        this->data = nullptr;
+
+        if (this->size > 0) {
+            this->data = std::make_unique<uint8_t[]>(this->size);
+            memcpy(this->data.get(), view.data, this->size);
+        }
+    }
+
     /*
      * Construct packet from ENet event.
+     * Malformed packets leave the default (empty) packet.
      */
-    Packet::Packet(ENetEvent* event) {
-        uint8_t* bytes = (uint8_t*)event->packet->data;
+    Packet::Packet(ENetEvent* event) : Packet() {
+        if (event->packet == nullptr) return;
+
+        const uint8_t* bytes = (const uint8_t*)event->packet->data;
         size_t size = event->packet->dataLength;
 
         if (size <= 0) return;
-        this->deserialize(bytes);
+        this->deserialize(bytes, size);
     }
 
     /*
@@ -94,58 +118,99 @@ namespace snow {
     uint64_t Packet::get_size() const noexcept {
         uint64_t size_total = 0;
 
+        uint64_t payload_size = (this->data != nullptr) ? this->size : 0;
+
         size_total += _UUID_SIZE;
-        size_total += sizeof(this->size);
+        size_total += varint_size(payload_size);
 
-        size_total += this->size;
+        size_total += payload_size;
 
         return size_total;
     }
 
     /*
      * Serializes the packet contents into a byte array.
+     * The caller owns the returned buffer and must free() it.
      */
     uint8_t* Packet::serialize() const {
-        uint64_t size_total = this->get_size();
+        size_t size_total = this->get_size();
         uint8_t* buffer = (uint8_t*)malloc(size_total);
-        uint64_t offset = 0;
 
-        memcpy((char*)buffer, this->uuid, _UUID_SIZE);
-        offset += _UUID_SIZE;
+        PacketWriter writer(buffer, size_total);
+        this->serialize(writer);
 
-        serialize_uint64_t(buffer + offset, this->size);
-        offset += sizeof(this->size);
+        return buffer;
+    }
 
-        if (this->data != nullptr && this->size > 0) {
-            memcpy((buffer + offset), this->data.get(), this->size);
+    /*
+     * Serializes the packet contents into writer.
+     * Wire format: UUID (16 bytes), payload size (varint), payload.
+     */
+    bool Packet::serialize(PacketWriter& writer) const {
+        uint64_t payload_size = (this->data != nullptr) ? this->size : 0;
+
+        writer.write_uuid(this->uuid);
+        writer.write_varint(payload_size);
+        writer.write_bytes(this->data.get(), payload_size);
+
+        return writer.ok();
+    }
+
+    /*
+     * Serializes straight into a new ENet packet,
+     * skipping the intermediate heap buffer. The first
+     * headroom bytes are left for the caller to fill.
+     */
+    ENetPacket* Packet::create_enet_packet(uint32_t flags, size_t headroom) const {
+        size_t size_total = headroom + this->get_size();
+        ENetPacket* enet_packet = enet_packet_create(nullptr, size_total, flags);
+        if (enet_packet == nullptr) {
+            return nullptr;
         }
 
-        return buffer;
+        PacketWriter writer(enet_packet->data + headroom, enet_packet->dataLength - headroom);
+        this->serialize(writer);
+
+        return enet_packet;
     }
 
     /*
-     * Deserialize the given byte array into the packet object.
-     * Modifies the current packet object.
+     * Validate a received buffer and point view into it.
+     * Nothing is allocated or copied; the declared payload size must
+     * exactly match the bytes actually received.
      */
-    bool Packet::deserialize(const uint8_t* buffer) {
-        uint64_t offset = 0;
+    bool Packet::parse(const uint8_t* buffer, size_t length, PacketView& view) {
+        PacketReader reader(buffer, length);
 
-        // UUID
-        memcpy(this->uuid, buffer, _UUID_SIZE);
-        offset += _UUID_SIZE;
+        uint64_t payload_size = 0;
+        if (!reader.read_uuid(view.uuid)) return false;
+        if (!reader.read_varint(payload_size)) return false;
+        if (payload_size != reader.remaining()) return false;
 
-        // Size
-        this->size = deserialize_uint64_t(buffer + offset);
-        offset += sizeof(this->size);
+        view.size = (size_t)payload_size;
+        view.data = nullptr;
+        return reader.read_view(view.data, view.size);
+    }
 
-        // Free any data currently being stored
-        if (this->data != nullptr) {
-            this->data.reset();
+    /*
+     * Deserialize the given byte array into the packet object.
+     * Modifies the current packet object only if the buffer is valid.
+     */
+    bool Packet::deserialize(const uint8_t* buffer, size_t length) {
+        PacketView view;
+        if (!Packet::parse(buffer, length, view)) {
+            return false;
         }
 
+        this->uuid = view.uuid;
+        this->size = view.size;
+        this->data = nullptr;
+
         // Now we copy the data
-        this->data = std::make_unique<uint8_t[]>(this->size);
-        memcpy(this->data.get(), (buffer + offset), this->size);
+        if (this->size > 0) {
+            this->data = std::make_unique<uint8_t[]>(this->size);
+            memcpy(this->data.get(), view.data, this->size);
+        }
 
         return true;
     }
@@ -0,0 +1,296 @@
+#include <cstring>
+
+#include "net/packet_io.h"
+#include "core/utils.h"
+#include "core/serialize.h"
+
+namespace snow {
+    /*
+     * Number of bytes write_varint() will use for value.
+     */
+    size_t varint_size(uint64_t value) {
+        size_t size = 1;
+        while (value >= 0x80) {
+            value >>= 7;
+            size++;
+        }
+        return size;
+    }
+
+    PacketWriter::PacketWriter(uint8_t* buffer, size_t capacity) {
+        this->m_buffer = buffer;
+        this->m_capacity = capacity;
+        this->m_offset = 0;
+        this->m_ok = (buffer != nullptr || capacity == 0);
+    }
+
+    /*
+     * Claim size bytes of the buffer.
+     * Returns nullptr if they don't fit.
+     */
+    uint8_t* PacketWriter::reserve(size_t size) {
+        if (!this->m_ok || size > this->m_capacity - this->m_offset) {
+            this->m_ok = false;
+            return nullptr;
+        }
+
+        uint8_t* position = this->m_buffer + this->m_offset;
+        this->m_offset += size;
+        return position;
+    }
+
+    bool PacketWriter::write_u8(uint8_t value) {
+        uint8_t* position = reserve(sizeof(uint8_t));
+        if (position == nullptr) return false;
+
+        position[0] = value;
+        return true;
+    }
+
+    bool PacketWriter::write_u16(uint16_t value) {
+        uint8_t* position = reserve(sizeof(uint16_t));
+        if (position == nullptr) return false;
+
+        position[0] = (uint8_t)(value >> 8);
+        position[1] = (uint8_t)value;
+        return true;
+    }
+
+    bool PacketWriter::write_u32(uint32_t value) {
+        uint8_t* position = reserve(sizeof(uint32_t));
+        if (position == nullptr) return false;
+
+        serialize_u32s(position, &value, 1);
+        return true;
+    }
+
+    bool PacketWriter::write_u64(uint64_t value) {
+        uint8_t* position = reserve(sizeof(uint64_t));
+        if (position == nullptr) return false;
+
+        serialize_uint64_t(position, value);
+        return true;
+    }
+
+    bool PacketWriter::write_float(float value) {
+        uint8_t* position = reserve(sizeof(float));
+        if (position == nullptr) return false;
+
+        serialize_float(position, value);
+        return true;
+    }
+
+    /*
+     * LEB128: seven bits per byte, low bits first,
+     * high bit set on every byte but the last.
+     */
+    bool PacketWriter::write_varint(uint64_t value) {
+        uint8_t* position = reserve(varint_size(value));
+        if (position == nullptr) return false;
+
+        while (value >= 0x80) {
+            *position++ = (uint8_t)(value | 0x80);
+            value >>= 7;
+        }
+        *position = (uint8_t)value;
+        return true;
+    }
+
+    bool PacketWriter::write_uuid(const Uuid& uuid) {
+        return write_bytes(uuid.bytes, _UUID_SIZE);
+    }
+
+    bool PacketWriter::write_bytes(const void* data, size_t size) {
+        uint8_t* position = reserve(size);
+        if (position == nullptr) return false;
+
+        if (size > 0) {
+            memcpy(position, data, size);
+        }
+        return true;
+    }
+
+    bool PacketWriter::write_floats(const float* values, size_t count) {
+        if (count > this->m_capacity / sizeof(float)) {
+            this->m_ok = false;
+            return false;
+        }
+
+        uint8_t* position = reserve(count * sizeof(float));
+        if (position == nullptr) return false;
+
+        serialize_floats(position, values, count);
+        return true;
+    }
+
+    bool PacketWriter::ok() const {
+        return this->m_ok;
+    }
+
+    size_t PacketWriter::size() const {
+        return this->m_offset;
+    }
+
+    size_t PacketWriter::remaining() const {
+        return this->m_capacity - this->m_offset;
+    }
+
+    uint8_t* PacketWriter::data() const {
+        return this->m_buffer;
+    }
+
+    PacketReader::PacketReader() {
+        this->m_buffer = nullptr;
+        this->m_length = 0;
+        this->m_offset = 0;
+        this->m_ok = true;
+    }
+
+    PacketReader::PacketReader(const uint8_t* buffer, size_t length) {
+        this->m_buffer = buffer;
+        this->m_length = (buffer != nullptr) ? length : 0;
+        this->m_offset = 0;
+        this->m_ok = true;
+    }
+
+    /*
+     * Advance past size bytes.
+     * Returns nullptr if the buffer is too short.
+     */
+    const uint8_t* PacketReader::consume(size_t size) {
+        if (!this->m_ok || size > this->m_length - this->m_offset) {
+            this->m_ok = false;
+            return nullptr;
+        }
+
+        const uint8_t* position = this->m_buffer + this->m_offset;
+        this->m_offset += size;
+        return position;
+    }
+
+    bool PacketReader::read_u8(uint8_t& value) {
+        const uint8_t* position = consume(sizeof(uint8_t));
+        if (position == nullptr) return false;
+
+        value = position[0];
+        return true;
+    }
+
+    bool PacketReader::read_u16(uint16_t& value) {
+        const uint8_t* position = consume(sizeof(uint16_t));
+        if (position == nullptr) return false;
+
+        value = (uint16_t)((position[0] << 8) | position[1]);
+        return true;
+    }
+
+    bool PacketReader::read_u32(uint32_t& value) {
+        const uint8_t* position = consume(sizeof(uint32_t));
+        if (position == nullptr) return false;
+
+        deserialize_u32s(position, &value, 1);
+        return true;
+    }
+
+    bool PacketReader::read_u64(uint64_t& value) {
+        const uint8_t* position = consume(sizeof(uint64_t));
+        if (position == nullptr) return false;
+
+        value = deserialize_uint64_t(position);
+        return true;
+    }
+
+    bool PacketReader::read_float(float& value) {
+        const uint8_t* position = consume(sizeof(float));
+        if (position == nullptr) return false;
+
+        value = deserialize_float(position);
+        return true;
+    }
+
+    /*
+     * Rejects truncated encodings, non-minimal ones (a zero final
+     * byte after the first, e.g. 0x80 0x00) and anything that
+     * doesn't fit in 64 bits. Every value has exactly one encoding.
+     */
+    bool PacketReader::read_varint(uint64_t& value) {
+        uint64_t result = 0;
+
+        for (size_t i = 0; i < _VARINT_MAX_SIZE; i++) {
+            uint8_t byte;
+            if (!read_u8(byte)) return false;
+
+            // Tenth byte may only contribute the top bit
+            if (i == _VARINT_MAX_SIZE - 1 && byte > 0x01) {
+                break;
+            }
+
+            result |= (uint64_t)(byte & 0x7F) << (7 * i);
+            if ((byte & 0x80) == 0) {
+                if (byte == 0 && i > 0) {
+                    break;
+                }
+                value = result;
+                return true;
+            }
+        }
+
+        this->m_ok = false;
+        return false;
+    }
+
+    bool PacketReader::read_uuid(Uuid& uuid) {
+        return read_bytes(uuid.bytes, _UUID_SIZE);
+    }
+
+    bool PacketReader::read_bytes(void* data, size_t size) {
+        const uint8_t* position = consume(size);
+        if (position == nullptr) return false;
+
+        if (size > 0) {
+            memcpy(data, position, size);
+        }
+        return true;
+    }
+
+    /*
+     * Point data at the next size bytes of the buffer without copying.
+     * The view is only valid while the underlying buffer is.
+     */
+    bool PacketReader::read_view(const uint8_t*& data, size_t size) {
+        const uint8_t* position = consume(size);
+        if (position == nullptr) return false;
+
+        data = position;
+        return true;
+    }
+
+    bool PacketReader::read_floats(float* values, size_t count) {
+        if (count > this->m_length / sizeof(float)) {
+            this->m_ok = false;
+            return false;
+        }
+
+        const uint8_t* position = consume(count * sizeof(float));
+        if (position == nullptr) return false;
+
+        deserialize_floats(position, values, count);
+        return true;
+    }
+
+    bool PacketReader::skip(size_t size) {
+        return consume(size) != nullptr;
+    }
+
+    bool PacketReader::ok() const {
+        return this->m_ok;
+    }
+
+    size_t PacketReader::offset() const {
+        return this->m_offset;
+    }
+
+    size_t PacketReader::remaining() const {
+        return this->m_length - this->m_offset;
+    }
+}
@@ -1,39 +1,162 @@
+#include <algorithm>
 #include <chrono>
+#include <cstddef>
 #include <cstdlib>
 #include <iostream>
 #include <thread>
 #include <functional>
 #include <cstring>
+#include <mutex>
 
 #include "enet/enet.h"
 
 #include "net/server.h"
 #include "core/utils.h"
 #include "net/packet.h"
+#include "net/control.h"
+#include "net/handoff.h"
+#include "net/context.h"
 
 namespace snow {
+    namespace {
+        /*
+         * Bytes of packet data in one of a peer's ENet command
+         * queues, counting no further than limit (0 = no limit).
+         */
+        size_t outgoing_bytes(ENetList* list, size_t limit) {
+            size_t total = 0;
+            for (ENetListIterator it = enet_list_begin(list); it != enet_list_end(list); it = enet_list_next(it)) {
+                const ENetOutgoingCommand* command = (const ENetOutgoingCommand*)it;
+                if (command->packet != nullptr) {
+                    total += command->fragmentLength;
+                }
+                if (limit > 0 && total > limit) {
+                    break;
+                }
+            }
+            return total;
+        }
+
+        /*
+         * Compare resume secrets without stopping at the first
+         * mismatch, so timing says nothing about how close a guess is.
+         */
+        bool secrets_equal(const ResumeSecret& a, const ResumeSecret& b) {
+            uint8_t difference = 0;
+            for (uint32_t i = 0; i < sizeof(a.bytes); i++) {
+                difference |= a.bytes[i] ^ b.bytes[i];
+            }
+            return difference == 0;
+        }
+
+        // Lets the intercept callback find the Server that owns a host
+        std::mutex host_registry_mutex;
+        std::unordered_map<const ENetHost*, Server*> host_registry;
+
+        /*
+         * The CONNECT command in the datagram ENet just received,
+         * or nullptr if it is anything else. Connects come from peers
+         * that don't have an id yet and are never compressed.
+         */
+        const ENetProtocolConnect* connect_command(const ENetHost* host) {
+            const uint8_t* data = host->receivedData;
+            size_t length = host->receivedDataLength;
+            if (data == nullptr || length < offsetof(ENetProtocolHeader, sentTime)) {
+                return nullptr;
+            }
+
+            const ENetProtocolHeader* header = (const ENetProtocolHeader*)data;
+            uint16_t peer_id = ENET_NET_TO_HOST_16(header->peerID);
+            uint16_t flags = peer_id & ENET_PROTOCOL_HEADER_FLAG_MASK;
+            peer_id &= ~(ENET_PROTOCOL_HEADER_FLAG_MASK | ENET_PROTOCOL_HEADER_SESSION_MASK);
+            if (peer_id != ENET_PROTOCOL_MAXIMUM_PEER_ID || (flags & ENET_PROTOCOL_HEADER_FLAG_COMPRESSED)) {
+                return nullptr;
+            }
+
+            size_t header_size = (flags & ENET_PROTOCOL_HEADER_FLAG_SENT_TIME)
+                ? sizeof(ENetProtocolHeader)
+                : offsetof(ENetProtocolHeader, sentTime);
+            if (host->checksum != nullptr) {
+                header_size += sizeof(enet_uint32);
+            }
+            if (length < header_size + sizeof(ENetProtocolConnect)) {
+                return nullptr;
+            }
+
+            const ENetProtocolConnect* command = (const ENetProtocolConnect*)(data + header_size);
+            if ((command->header.command & ENET_PROTOCOL_COMMAND_MASK) != ENET_PROTOCOL_COMMAND_CONNECT) {
+                return nullptr;
+            }
+            return command;
+        }
+
+        /*
+         * Answer a CONNECT datagram without creating a peer for it.
+         */
+        void send_admission_reply(ENetHost* host, const ENetProtocolConnect* command, AdmissionReply type, uint32_t value) {
+            uint8_t reply[_ADMISSION_REPLY_SIZE];
+            PacketWriter writer(reply, sizeof(reply));
+            writer.write_u16(_ADMISSION_MARKER);
+            writer.write_u8((uint8_t)type);
+            writer.write_u32(command->connectID);
+            writer.write_u32(value);
+
+            ENetBuffer buffer;
+            buffer.data = reply;
+            buffer.dataLength = writer.size();
+            enet_socket_send(host->socket, &host->receivedAddress, &buffer, 1);
+        }
+    }
+
     Server::Server(uint16_t port, uint32_t max_clients) {
         this->port = port;
         this->tick_rate = 20;
         this->max_clients = max_clients;
+        this->channels = ChannelTable::defaults();
+        this->admission = Admission::defaults();
+        this->backpressure = (BackpressureConfig){
+            .soft_limit = 256 * 1024,
+            .hard_limit = 2 * 1024 * 1024,
+            .broadcast_limit = 4 * 1024 * 1024,
+        };
+        this->m_congested_count = 0;
+        this->m_broadcast_queued = 0;
         this->m_host = nullptr;
+        this->m_tick = 0;
+        this->m_tick_start = 0;
+        this->m_flush_control = false;
+        this->m_enet_acquired = false;
+        this->m_running = false;
+        this->m_accepting = true;
+        this->m_handing_off = false;
 
         this->m_user_loop = nullptr;
         this->m_user_connect_callback = nullptr;
         this->m_user_disconnect_callback = nullptr;
+        this->m_user_backpressure_callback = nullptr;
     }
 
     Server::~Server() {
         debug_log("[SERVER] Stopping server...");
 
-        // Disconnect clients
+        // Disconnect clients. Use drain() first for a graceful shutdown;
+        // this only makes sure the disconnects actually go out.
         for (const ClientInfo& client : this->m_clients) {
-            enet_peer_disconnect(client.peer, 0);
+            release_state_slots(client.peer);
+            enet_peer_disconnect(client.peer, _DISCONNECT_REASON_SHUTDOWN);
+        }
+        if (this->m_host != nullptr) {
+            enet_host_flush(this->m_host);
         }
 
         // Destroy host instance
+        this->detach_host();
         enet_host_destroy(this->m_host);
         this->m_host = nullptr;
+
+        if (this->m_enet_acquired) {
+            Context::release_enet();
+        }
     }
 
     /**
@@ -42,10 +165,19 @@ namespace snow {
      * for communication.
      */
     void Server::init() {
-        if (enet_initialize() != 0) {
-            debug_error("[SERVER] Failed to initialize ENet.");
+        if (!this->m_enet_acquired) {
+            if (!Context::acquire_enet()) {
+                debug_error("[SERVER] Failed to initialize ENet.");
+                exit(EXIT_FAILURE);
+            }
+            this->m_enet_acquired = true;
+        }
+
+        if (this->channels.size() == 0) {
+            debug_error("[SERVER] Channel table is empty.");
             exit(EXIT_FAILURE);
         }
+        this->m_outgoing_messages.resize(this->channels.size());
 
         ENetAddress address;
         address.host = ENET_HOST_ANY;
@@ -53,7 +185,7 @@ namespace snow {
         this->m_host = enet_host_create(
             &address,
             this->max_clients,      // Maximum player count
-            0,                      // Communication channels
+            this->channels.enet_channel_count(),  // Communication channels
             0,                      // Incoming bandwidth
             0                       // Outgoing bandwidth
         );
@@ -63,6 +195,355 @@ namespace snow {
             debug_error("Failed to create server host");
             exit(EXIT_FAILURE);
         }
+        this->attach_host();
+    }
+
+    /**
+     * Initialize the server on a socket handed over by a
+     * previous server process (see handoff()). Blocks until the
+     * old process connects to path or timeout (ms) expires.
+     * Returns false on failure so the caller can fall back to init().
+     */
+    bool Server::init_from_handoff(const char* path, uint32_t timeout) {
+        if (!this->m_enet_acquired) {
+            if (!Context::acquire_enet()) {
+                debug_error("[SERVER] Failed to initialize ENet.");
+                return false;
+            }
+            this->m_enet_acquired = true;
+        }
+
+        if (this->channels.size() == 0) {
+            debug_error("[SERVER] Channel table is empty.");
+            return false;
+        }
+
+        HandoffState state;
+        if (!receive_handoff(path, state, timeout)) {
+            return false;
+        }
+
+        // Create an unbound host, then swap in the inherited socket
+        this->m_host = enet_host_create(
+            nullptr,
+            this->max_clients,
+            this->channels.enet_channel_count(),
+            0,
+            0
+        );
+        if (this->m_host == nullptr) {
+            debug_error("[SERVER] Failed to create server host");
+            enet_socket_destroy(state.socket);
+            return false;
+        }
+        enet_socket_destroy(this->m_host->socket);
+        this->m_host->socket = state.socket;
+        enet_socket_set_option(this->m_host->socket, ENET_SOCKOPT_NONBLOCK, 1);
+        enet_socket_get_address(this->m_host->socket, &this->m_host->address);
+        this->port = this->m_host->address.port;
+        this->attach_host();
+
+        this->m_outgoing_messages.resize(this->channels.size());
+
+        uint64_t expires = get_local_timestamp() + _HANDOFF_RESUME_WINDOW;
+        for (const HandoffClient& client : state.clients) {
+            this->m_resumable[client.uuid] = (ResumableClient){
+                .secret = client.secret,
+                .expires = expires,
+            };
+        }
+        this->m_handoff_state = std::move(state.user_state);
+
+        debug_log("[SERVER] Took over socket with %zu clients.", state.clients.size());
+        return true;
+    }
+
+    /*
+     * Game state passed along by the previous process.
+     */
+    const std::vector<uint8_t>& Server::get_handoff_state() const {
+        return this->m_handoff_state;
+    }
+
+    /*
+     * Ask the main loop to return after the current tick.
+     * Safe to call from any thread.
+     */
+    void Server::stop() {
+        this->m_running = false;
+    }
+
+    /*
+     * Graceful shutdown. Call after start() has returned.
+     * Stops accepting connections, flushes queued packets, waits for
+     * reliable data to be acknowledged, then disconnects every client.
+     * Clients still around after timeout (ms) are reset.
+     * Returns true if every client left cleanly.
+     */
+    bool Server::drain(uint32_t timeout) {
+        if (this->m_host == nullptr) {
+            return true;
+        }
+
+        debug_log("[SERVER] Draining...");
+        this->m_accepting = false;
+        this->reject_pending_handshakes(_DISCONNECT_REASON_SHUTDOWN);
+        this->flush_outgoing();
+
+        uint64_t deadline = get_local_timestamp() + timeout;
+        wait_for_acknowledgements(deadline);
+
+        // Disconnect once each peer's queues are empty
+        for (const ClientInfo& client : this->m_clients) {
+            enet_peer_disconnect_later(client.peer, _DISCONNECT_REASON_SHUTDOWN);
+        }
+        while (!this->m_clients.empty() && get_local_timestamp() < deadline) {
+            drain_events(10);
+        }
+
+        bool clean = this->m_clients.empty();
+        for (const ClientInfo& client : this->m_clients) {
+            release_state_slots(client.peer);
+            enet_peer_reset(client.peer);
+        }
+        this->m_clients.clear();
+        this->m_client_lookup.clear();
+        this->m_send_budgets.clear();
+        this->m_congested_count = 0;
+
+        debug_log("[SERVER] Drained %s.", clean ? "cleanly" : "with timeouts");
+        return clean;
+    }
+
+    /*
+     * Hand the UDP socket and client table to a replacement process
+     * waiting in init_from_handoff() on path. Clients are told to
+     * reconnect and reclaim their UUID on the new process; the port
+     * never stops being bound. Call after start() has returned.
+     */
+    bool Server::handoff(const char* path, uint32_t timeout, const std::vector<uint8_t>& user_state) {
+        if (this->m_host == nullptr) {
+            return false;
+        }
+
+        // From here on connects go unanswered; ENet resends
+        // them until the replacement picks them up
+        this->m_accepting = false;
+        this->m_handing_off = true;
+        this->reject_pending_handshakes(_DISCONNECT_REASON_SHUTDOWN);
+        this->flush_outgoing();
+
+        uint64_t deadline = get_local_timestamp() + timeout;
+        wait_for_acknowledgements(deadline);
+
+        HandoffState state;
+        state.socket = this->m_host->socket;
+        state.user_state = user_state;
+        for (const ClientInfo& client : this->m_clients) {
+            state.clients.push_back((HandoffClient){
+                .uuid = client.uuid,
+                .secret = client.secret,
+                .address = client.peer->address,
+            });
+        }
+
+        // The notice has to be acknowledged while the socket is still
+        // ours; once it's shared, either process may read the ack
+        for (const ClientInfo& client : this->m_clients) {
+            enet_peer_disconnect_later(client.peer, _DISCONNECT_REASON_HANDOFF);
+        }
+        while (!this->m_clients.empty() && get_local_timestamp() < deadline) {
+            drain_events(10);
+        }
+
+        if (!send_handoff(path, state, timeout)) {
+            // Clients already left; let them resume here instead
+            uint64_t expires = get_local_timestamp() + _HANDOFF_RESUME_WINDOW;
+            for (const HandoffClient& client : state.clients) {
+                this->m_resumable[client.uuid] = (ResumableClient){
+                    .secret = client.secret,
+                    .expires = expires,
+                };
+            }
+            this->m_handing_off = false;
+            this->m_accepting = true;
+            return false;
+        }
+
+        // The replacement owns the socket from here on. Whoever
+        // didn't acknowledge in time only gets a best effort notice.
+        for (const ClientInfo& client : this->m_clients) {
+            release_state_slots(client.peer);
+            enet_peer_disconnect_now(client.peer, _DISCONNECT_REASON_HANDOFF);
+        }
+        this->m_clients.clear();
+        this->m_client_lookup.clear();
+        this->m_send_budgets.clear();
+        this->m_congested_count = 0;
+
+        this->detach_host();
+        enet_host_destroy(this->m_host);
+        this->m_host = nullptr;
+        this->m_handing_off = false;
+
+        debug_log("[SERVER] Handoff complete.");
+        return true;
+    }
+
+    /*
+     * Register the host with the intercept callback, which sees
+     * every datagram before ENet acts on it.
+     */
+    void Server::attach_host() {
+        std::lock_guard<std::mutex> lock(host_registry_mutex);
+        host_registry[this->m_host] = this;
+        this->m_host->intercept = Server::intercept;
+    }
+
+    void Server::detach_host() {
+        if (this->m_host == nullptr) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(host_registry_mutex);
+        host_registry.erase(this->m_host);
+        this->m_host->intercept = nullptr;
+    }
+
+    /*
+     * ENet intercept callback. Returns 1 to swallow a datagram,
+     * 0 to let ENet process it. Only connects are looked at.
+     */
+    int Server::intercept(ENetHost* host, ENetEvent*) {
+        const ENetProtocolConnect* command = connect_command(host);
+        if (command == nullptr) {
+            return 0;
+        }
+
+        Server* server = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(host_registry_mutex);
+            auto server_it = host_registry.find(host);
+            if (server_it != host_registry.end()) {
+                server = server_it->second;
+            }
+        }
+        if (server == nullptr) {
+            return 0;
+        }
+
+        // Mid-handoff, stay quiet so the connect is retried
+        // against the replacement process
+        if (server->m_handing_off) {
+            return 1;
+        }
+        return server->admit_connect(command) ? 0 : 1;
+    }
+
+    /*
+     * Admission for one CONNECT datagram, before ENet allocates a
+     * peer or sends anything. A connect without a valid cookie is
+     * answered with one and dropped; the client connects again with
+     * the cookie as its connect data, proving it owns its address.
+     * Returns true to let ENet accept the connection.
+     */
+    bool Server::admit_connect(const ENetProtocolConnect* command) {
+        const ENetAddress& address = this->m_host->receivedAddress;
+        uint32_t data = ENET_NET_TO_HOST_32(command->data);
+        uint64_t now = get_local_timestamp();
+
+        if (!this->m_accepting) {
+            send_admission_reply(this->m_host, command, AdmissionReply::Rejected, _DISCONNECT_REASON_SHUTDOWN);
+            return false;
+        }
+
+        // First attempt, or a cookie that expired or was never ours.
+        // The source may be spoofed, so it costs no per-IP state.
+        if (!this->m_admission.check_cookie(this->admission, address, data, now)) {
+            uint32_t cookie = this->m_admission.make_cookie(this->admission, address, data, now);
+            send_admission_reply(this->m_host, command, AdmissionReply::Cookie, cookie);
+            return false;
+        }
+
+        AdmissionResult result = this->m_admission.admit(
+            this->admission, address, this->m_pending_handshakes.size(), now
+        );
+        if (result == AdmissionResult::RateLimited) {
+            debug_warn("[SERVER] Connection rate limited.");
+            send_admission_reply(this->m_host, command, AdmissionReply::Rejected, _DISCONNECT_REASON_RATE_LIMITED);
+            return false;
+        }
+        if (result == AdmissionResult::Busy) {
+            debug_warn("[SERVER] Too many pending handshakes.");
+            send_admission_reply(this->m_host, command, AdmissionReply::Rejected, _DISCONNECT_REASON_BUSY);
+            return false;
+        }
+
+        return true;
+    }
+
+    /*
+     * Service the host until no peer has unacknowledged
+     * reliable data or unsent packets, or the deadline passes.
+     */
+    bool Server::wait_for_acknowledgements(uint64_t deadline) {
+        while (get_local_timestamp() < deadline) {
+            bool pending = false;
+            for (const ClientInfo& client : this->m_clients) {
+                ENetPeer* peer = client.peer;
+                if (!enet_list_empty(&peer->outgoingCommands)
+                    || !enet_list_empty(&peer->outgoingSendReliableCommands)
+                    || !enet_list_empty(&peer->sentReliableCommands)) {
+                    pending = true;
+                    break;
+                }
+            }
+
+            if (!pending) {
+                return true;
+            }
+            drain_events(10);
+        }
+        return false;
+    }
+
+    /*
+     * Event handling while shutting down: refuse new connections,
+     * drop incoming data, and keep the client list up to date.
+     */
+    void Server::drain_events(uint32_t timeout) {
+        ENetEvent event;
+
+        if (enet_host_service(this->m_host, &event, timeout) <= 0) {
+            return;
+        }
+
+        do {
+            switch (event.type)
+            {
+                case ENET_EVENT_TYPE_CONNECT:
+                {
+                    enet_peer_disconnect_now(event.peer, _DISCONNECT_REASON_SHUTDOWN);
+                    break;
+                }
+
+                case ENET_EVENT_TYPE_DISCONNECT:
+                {
+                    if (this->m_user_disconnect_callback != nullptr) {
+                        this->m_user_disconnect_callback(*this, event);
+                    }
+                    disconnect_client(event);
+                    break;
+                }
+
+                default:
+                {
+                    break;
+                }
+            }
+
+            enet_packet_destroy(event.packet);
+        } while (enet_host_check_events(this->m_host, &event) > 0);
     }
 
     /*
@@ -79,6 +560,7 @@ namespace snow {
         this->m_user_connect_callback = connect_callback;
         this->m_user_disconnect_callback = disconnect_callback;
 
+        this->m_running = true;
         main_loop();
     }
 
@@ -87,6 +569,7 @@ namespace snow {
      */
     void Server::poll_events() {
         ENetEvent event;
+        this->m_flush_control = false;
 
         while (enet_host_service(this->m_host, &event, 0) > 0)
         {
@@ -96,19 +579,12 @@ namespace snow {
                 {
                     debug_log("[SERVER] New connection.");
 
-                    bool result = true;
-                    if (this->m_user_connect_callback != nullptr) {
-                        debug_log("[SERVER] Calling user connect callback...");
-                        result = this->m_user_connect_callback(*this, event);
-                    }
-
-                    // Result value for callback determines if
-                    // we continue allowing the client to connect.
-                    if (result) {
-                        debug_log("[SERVER] Handling new connection...");
-                        this->handle_new_connection(event);
+                    if (!this->m_accepting) {
+                        enet_peer_disconnect_now(event.peer, _DISCONNECT_REASON_SHUTDOWN);
+                        break;
                     }
 
+                    this->accept_connection(event);
                     break;
                 }
 
@@ -116,20 +592,37 @@ namespace snow {
                 {
                     debug_log("[SERVER] Message received.");
 
-                    Packet packet(&event);
+                    if (event.channelID == this->channels.control_channel()) {
+                        handle_control_message(event, get_monotonic_time_us());
+                        break;
+                    }
+
+                    // Users only ever see their own channel ids
+                    event.channelID = this->channels.user_channel(event.channelID);
+                    if (event.channelID < this->channels.size()) {
+                        this->channels.record_receive(event.channelID, event.packet->dataLength);
+                    }
+
+                    // Reject malformed packets before allocating anything
+                    PacketView view;
+                    if (!Packet::parse(event.packet->data, event.packet->dataLength, view)) {
+                        debug_error("[SERVER] Received malformed packet.");
+                        break;
+                    }
 
                     // Client validation check
-                    auto peer_it = this->m_client_lookup.find(packet.uuid);
+                    auto peer_it = this->m_client_lookup.find(view.uuid);
                     if (peer_it == this->m_client_lookup.end()) {
-                        debug_error("[SERVER] Client with UUID %s does not exist.", packet.uuid);
+                        debug_error("[SERVER] Client with UUID %s does not exist.", view.uuid.to_string().c_str());
                         break;
                     }
-                    ENetPeer* peer = this->m_client_lookup[packet.uuid];
+                    ENetPeer* peer = peer_it->second;
                     if (peer->connectID != event.peer->connectID) {
                         debug_error("[SERVER] Client sent packet with incorrect UUID");
                         break;
                     }
 
+                    Packet packet(view);
                     Message msg = {
                         .event = event,
                         .packet = packet
@@ -143,6 +636,11 @@ namespace snow {
                 {
                     debug_log("[SERVER] Client disconnected.");
 
+                    // Never admitted, so the user never saw it connect
+                    if (this->m_pending_handshakes.erase(event.peer) > 0) {
+                        break;
+                    }
+
                     if (this->m_user_disconnect_callback != nullptr) {
                         this->m_user_disconnect_callback(*this, event);
                     }
@@ -159,34 +657,214 @@ namespace snow {
 
             enet_packet_destroy(event.packet);
         }
+
+        this->expire_handshakes();
+
+        // Time sync replies and challenges shouldn't wait for the next tick
+        if (this->m_flush_control) {
+            enet_host_flush(this->m_host);
+        }
+    }
+
+    /*
+     * Handle a message on the internal control channel.
+     */
+    void Server::handle_control_message(ENetEvent& event, uint64_t received_at) {
+        PacketReader reader(event.packet->data, event.packet->dataLength);
+
+        uint8_t type = 0;
+        if (!reader.read_u8(type)) {
+            return;
+        }
+
+        switch ((ControlType)type)
+        {
+            case ControlType::TimeSyncRequest:
+            {
+                uint64_t client_send = 0;
+                if (!reader.read_u64(client_send)) {
+                    debug_error("[SERVER] Malformed time sync request.");
+                    return;
+                }
+
+                ENetPacket* response = enet_packet_create(
+                    nullptr, _CONTROL_MAX_SIZE, ENET_PACKET_FLAG_UNSEQUENCED
+                );
+                if (response == nullptr) {
+                    return;
+                }
+
+                PacketWriter writer(response->data, response->dataLength);
+                writer.write_u8((uint8_t)ControlType::TimeSyncResponse);
+                writer.write_u64(client_send);
+                writer.write_u64(received_at);
+                writer.write_u64(get_monotonic_time_us());
+                writer.write_u64(this->m_tick);
+                writer.write_u64(this->m_tick_start);
+                writer.write_u16(this->tick_rate);
+                response->dataLength = writer.size();
+
+                if (enet_peer_send(event.peer, this->channels.control_channel(), response) < 0) {
+                    enet_packet_destroy(response);
+                    return;
+                }
+                this->m_flush_control = true;
+
+                break;
+            }
+
+            case ControlType::Resume:
+            {
+                auto pending_it = this->m_pending_handshakes.find(event.peer);
+                if (pending_it == this->m_pending_handshakes.end()) {
+                    debug_error("[SERVER] Unexpected resume request.");
+                    return;
+                }
+                this->m_pending_handshakes.erase(pending_it);
+
+                Uuid uuid;
+                ResumeSecret secret;
+                if (!reader.read_uuid(uuid) || !reader.read_uuid(secret)) {
+                    debug_error("[SERVER] Malformed resume request.");
+                    enet_peer_disconnect_now(event.peer, _DISCONNECT_REASON_REJECTED);
+                    return;
+                }
+
+                this->complete_handshake(event.peer, _CONNECT_RESUME, uuid, secret);
+                break;
+            }
+
+            default:
+            {
+                debug_error("[SERVER] Unknown control message %u.", type);
+                break;
+            }
+        }
     }
 
     /*
      * Finalize new client connection.
      */
-    void Server::handle_new_connection(ENetEvent& event) {
-        // Create ClientInfo object for client
+    void Server::handle_new_connection(ENetEvent& event, const Uuid& uuid) {
+        // Create ClientInfo object for client, with a fresh
+        // secret for every connection, resumed or not
         ClientInfo client;
         client.peer = event.peer;
-        client.uuid = generate_uuid();
+        client.uuid = uuid;
+        fill_secure_random(client.secret.bytes, sizeof(client.secret.bytes));
 
-        // Send client their UUID
+        // Send client their UUID, with the secret as the payload
         Packet uuid_packet;
-        strcpy(uuid_packet.uuid, client.uuid.data());
-        _send_packet_immediate(uuid_packet, client.peer, true, snow::_CHANNEL_RELIABLE);
+        uuid_packet.uuid = client.uuid;
+        uuid_packet.size = sizeof(client.secret.bytes);
+        uuid_packet.data = std::make_unique<uint8_t[]>(uuid_packet.size);
+        memcpy(uuid_packet.data.get(), client.secret.bytes, uuid_packet.size);
+        _send_packet_immediate(uuid_packet, client.peer, ENET_PACKET_FLAG_RELIABLE, snow::_CHANNEL_RELIABLE);
         debug_log("[SERVER] UUID sent to client.");
 
         // Add client to server
-        this->m_client_lookup[client.uuid.data()] = client.peer;
+        this->m_client_lookup[client.uuid] = client.peer;
         this->m_clients.push_back(client);
-        // this->client_lookup.insert(std::make_pair(client.uuid.data(), client.peer));
+        this->m_send_budgets[client.peer] = (SendBudget){};
+    }
+
+    /*
+     * ENet connected a peer that already passed admit_connect().
+     * New clients are admitted right away; resuming clients first
+     * have to say which UUID they want back.
+     */
+    void Server::accept_connection(ENetEvent& event) {
+        uint32_t mode = event.data & _CONNECT_MODE_MASK;
+        if (mode != _CONNECT_RESUME) {
+            this->complete_handshake(event.peer, mode, Uuid{}, ResumeSecret{});
+            return;
+        }
+
+        this->m_pending_handshakes[event.peer] = (PendingHandshake){
+            .deadline = get_local_timestamp() + this->admission.handshake_timeout,
+        };
+    }
+
+    /*
+     * If the user callback agrees, promote the peer to a client.
+     * Resuming clients get their old UUID back if it was handed
+     * over to us, is still claimable, isn't already in use and
+     * they sent the secret it was handed over with.
+     */
+    void Server::complete_handshake(ENetPeer* peer, uint32_t mode, const Uuid& uuid, const ResumeSecret& secret) {
+        // Present the connection to the user with the mode as its data
+        ENetEvent connect_event = {};
+        connect_event.type = ENET_EVENT_TYPE_CONNECT;
+        connect_event.peer = peer;
+        connect_event.data = mode;
+
+        bool result = true;
+        if (this->m_user_connect_callback != nullptr) {
+            debug_log("[SERVER] Calling user connect callback...");
+            result = this->m_user_connect_callback(*this, connect_event);
+        }
+
+        // Result value for callback determines if
+        // we continue allowing the client to connect.
+        if (!result) {
+            debug_log("[SERVER] Connection rejected by user.");
+            enet_peer_disconnect_now(peer, _DISCONNECT_REASON_REJECTED);
+            return;
+        }
+
+        bool resumed = false;
+        if (!uuid.is_nil()) {
+            auto resumable_it = this->m_resumable.find(uuid);
+            resumed = resumable_it != this->m_resumable.end()
+                && resumable_it->second.expires >= get_local_timestamp()
+                && secrets_equal(resumable_it->second.secret, secret)
+                && this->m_client_lookup.find(uuid) == this->m_client_lookup.end();
+
+            // One attempt per claim, so secrets can't be guessed
+            if (resumable_it != this->m_resumable.end()) {
+                this->m_resumable.erase(resumable_it);
+            }
+            debug_log("[SERVER] Client %s.", resumed ? "resumed" : "could not resume");
+        }
+
+        debug_log("[SERVER] Handling new connection...");
+        this->handle_new_connection(connect_event, resumed ? uuid : generate_uuid());
+    }
+
+    /*
+     * Reset resuming connections that never sent their UUID.
+     */
+    void Server::expire_handshakes() {
+        uint64_t now = get_local_timestamp();
+
+        auto it = this->m_pending_handshakes.begin();
+        while (it != this->m_pending_handshakes.end()) {
+            if (it->second.deadline <= now) {
+                debug_warn("[SERVER] Handshake timed out.");
+                enet_peer_disconnect_now(it->first, _DISCONNECT_REASON_HANDSHAKE_TIMEOUT);
+                it = this->m_pending_handshakes.erase(it);
+            }
+            else {
+                it++;
+            }
+        }
+    }
+
+    /*
+     * Reset every connection still in the handshake.
+     */
+    void Server::reject_pending_handshakes(uint32_t reason) {
+        for (const auto& pending : this->m_pending_handshakes) {
+            enet_peer_disconnect_now(pending.first, reason);
+        }
+        this->m_pending_handshakes.clear();
     }
 
     void Server::main_loop() {
         const int32_t tick_time = 1000.0 / this->tick_rate;
         uint64_t last_tick_timestamp = get_local_timestamp();
 
-        while (1) {
+        while (this->m_running) {
             uint64_t time_since_last_tick = get_local_timestamp() - last_tick_timestamp;
 
             if (time_since_last_tick < tick_time) {
@@ -200,25 +878,52 @@ namespace snow {
             }
 
             last_tick_timestamp = get_local_timestamp();
+            this->tick();
+        }
+    }
+
+    /*
+     * Run one server tick: poll, run the user loop, send.
+     * Called by main_loop() or by a Context worker.
+     */
+    void Server::tick() {
+        this->m_tick++;
+        this->m_tick_start = get_monotonic_time_us();
 
-            debug_log("[SERVER] Polling Events...");
-            this->poll_events();
+        debug_log("[SERVER] Polling Events...");
+        this->poll_events();
 
-            debug_log("[SERVER] Running user loop...");
-            this->m_user_loop(*this);
+        debug_log("[SERVER] Running user loop...");
+        this->m_user_loop(*this);
+
+        // Send out all queued packets
+        this->flush_outgoing();
+    }
+
+    /*
+     * Hand every queued packet to ENet, one channel at a time.
+     */
+    void Server::flush_outgoing() {
+        uint64_t now = get_local_timestamp();
 
-            // Send out all queued packets
-            while (!this->m_outgoing_messages.empty()) {
-                QueuePacket& message = this->m_outgoing_messages.front();
+        this->update_send_budgets();
+        this->flush_state_slots();
 
+        for (std::deque<QueuePacket>& queue : this->m_outgoing_messages) {
+            while (!queue.empty()) {
+                QueuePacket& message = queue.front();
+
+                size_t bytes = 0;
                 if (message.dest != nullptr) {
-                    _send_packet_immediate(message.packet, message.dest, message.reliable, message.channel);
+                    bytes = _send_packet_immediate(message.packet, message.dest, message.flags, message.channel);
                 }
                 else {
-                    _broadcast_packet_immediate(message.packet, message.reliable, message.channel);
+                    bytes = _broadcast_packet_immediate(message.packet, message.flags, message.channel);
                 }
+                this->channels.record_send(message.channel, bytes, now - message.queued_at);
 
-                this->m_outgoing_messages.pop();
+                track_queued(message, false);
+                queue.pop_front();
             }
         }
     }
@@ -232,11 +937,30 @@ namespace snow {
         auto it = this->m_clients.begin();
         while (it != this->m_clients.end()) {
             if (it->peer->connectID == event.peer->connectID) {
-                this->m_client_lookup.erase(it->uuid.data());
+                this->m_client_lookup.erase(it->uuid);
                 this->m_clients.erase(it);
+                release_state_slots(event.peer);
+
+                // Don't send queued packets to whoever gets this peer next
+                for (std::deque<QueuePacket>& queue : this->m_outgoing_messages) {
+                    queue.erase(
+                        std::remove_if(queue.begin(), queue.end(),
+                            [&event](const QueuePacket& message) { return message.dest == event.peer; }),
+                        queue.end()
+                    );
+                }
+
+                auto budget_it = this->m_send_budgets.find(event.peer);
+                if (budget_it != this->m_send_budgets.end()) {
+                    if (budget_it->second.congested) {
+                        this->m_congested_count--;
+                    }
+                    this->m_send_budgets.erase(budget_it);
+                }
                 debug_log("[SERVER] Client successfully disconnected.");
                 return;
             }
+            it++;
         }
 
         if (!found) {
@@ -244,22 +968,368 @@ namespace snow {
         }
     }
 
+    /*
+     * Queue a packet using the channel's configured delivery mode.
+     */
+    void Server::send_packet(const Packet& packet, ENetPeer* dest, uint8_t channel) {
+        if (channel >= this->channels.size()) {
+            debug_error("[SERVER] Channel %u does not exist.", channel);
+            return;
+        }
+        queue_packet(packet, dest, this->channels.packet_flags(channel), channel);
+    }
+
+    /*
+     * Queue a packet, overriding the channel's delivery mode.
+     */
     void Server::send_packet(const Packet& packet, ENetPeer* dest, bool reliable, uint8_t channel) {
-        this->m_outgoing_messages.emplace((QueuePacket){
-            .packet = std::move(packet),
-            .dest = dest,
-            .reliable = reliable,
-            .channel = channel,
-        });
+        uint32_t flags = reliable ? ENET_PACKET_FLAG_RELIABLE : ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT;
+        queue_packet(packet, dest, flags, channel);
+    }
+
+    void Server::broadcast_packet(const Packet& packet, uint8_t channel) {
+        if (channel >= this->channels.size()) {
+            debug_error("[SERVER] Channel %u does not exist.", channel);
+            return;
+        }
+        queue_packet(packet, nullptr, this->channels.packet_flags(channel), channel);
     }
 
     void Server::broadcast_packet(const Packet& packet, bool reliable, uint8_t channel) {
-        this->m_outgoing_messages.emplace((QueuePacket){
-            .packet = std::move(packet),
-            .dest = nullptr,
-            .reliable = reliable,
+        uint32_t flags = reliable ? ENET_PACKET_FLAG_RELIABLE : ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT;
+        queue_packet(packet, nullptr, flags, channel);
+    }
+
+    /*
+     * Store the latest value for a peer's state slot.
+     * An unsent older value is overwritten in place, so only
+     * the newest value for each key is ever sent. The peer must
+     * be a connected client.
+     */
+    void Server::set_state(ENetPeer* peer, uint32_t key, const Packet& packet, uint8_t channel) {
+        if (channel >= this->channels.size()) {
+            debug_error("[SERVER] Channel %u does not exist.", channel);
+            return;
+        }
+
+        // A peer that already left would keep its slot forever and
+        // pass the stale value on to whoever ENet gives the peer next
+        if (this->m_send_budgets.find(peer) == this->m_send_budgets.end()) {
+            debug_error("[SERVER] Peer is not a connected client.");
+            return;
+        }
+
+        StateSlot& slot = this->m_state_slots[peer][key];
+        if (slot.dirty) {
+            this->channels.record_drop(channel);
+        }
+        slot.packet = packet;
+        slot.channel = channel;
+        slot.dirty = true;
+    }
+
+    void Server::broadcast_state(uint32_t key, const Packet& packet, uint8_t channel) {
+        for (const ClientInfo& client : this->m_clients) {
+            set_state(client.peer, key, packet, channel);
+        }
+    }
+
+    void Server::clear_state(ENetPeer* peer, uint32_t key) {
+        auto peer_it = this->m_state_slots.find(peer);
+        if (peer_it == this->m_state_slots.end()) {
+            return;
+        }
+
+        auto slot_it = peer_it->second.find(key);
+        if (slot_it == peer_it->second.end()) {
+            return;
+        }
+
+        ENetPacket* in_flight = slot_it->second.in_flight;
+        if (in_flight != nullptr && --in_flight->referenceCount == 0) {
+            enet_packet_destroy(in_flight);
+        }
+        peer_it->second.erase(slot_it);
+    }
+
+    /*
+     * Send the current value of every dirty state slot.
+     * A slot keeps a reference to the last ENet packet it sent. While
+     * ENet still holds that packet in the peer's queue, the new value
+     * waits in the slot instead of piling up behind it.
+     */
+    void Server::flush_state_slots() {
+        for (auto& peer_slots : this->m_state_slots) {
+            ENetPeer* peer = peer_slots.first;
+
+            for (auto& entry : peer_slots.second) {
+                StateSlot& slot = entry.second;
+
+                if (slot.in_flight != nullptr) {
+                    if (slot.in_flight->referenceCount > 1) {
+                        continue;
+                    }
+                    if (--slot.in_flight->referenceCount == 0) {
+                        enet_packet_destroy(slot.in_flight);
+                    }
+                    slot.in_flight = nullptr;
+                }
+
+                if (!slot.dirty) {
+                    continue;
+                }
+
+                size_t size = slot.packet.get_size();
+                ENetPacket* enet_packet = create_enet_packet(
+                    slot.packet, this->channels.packet_flags(slot.channel), slot.channel
+                );
+                if (enet_packet == nullptr) {
+                    continue;
+                }
+
+                // Hold our own reference so we can tell when ENet is done
+                enet_packet->referenceCount++;
+                if (enet_peer_send(peer, this->channels.enet_channel(slot.channel), enet_packet) < 0) {
+                    enet_packet_destroy(enet_packet);
+                    continue;
+                }
+
+                slot.in_flight = enet_packet;
+                slot.dirty = false;
+                this->channels.record_send(slot.channel, size, 0);
+            }
+        }
+    }
+
+    /*
+     * Drop every state slot belonging to a peer.
+     */
+    void Server::release_state_slots(ENetPeer* peer) {
+        auto peer_it = this->m_state_slots.find(peer);
+        if (peer_it == this->m_state_slots.end()) {
+            return;
+        }
+
+        for (auto& entry : peer_it->second) {
+            ENetPacket* in_flight = entry.second.in_flight;
+            if (in_flight != nullptr && --in_flight->referenceCount == 0) {
+                enet_packet_destroy(in_flight);
+            }
+        }
+        this->m_state_slots.erase(peer_it);
+    }
+
+    const ChannelStats& Server::get_channel_stats(uint8_t channel) const {
+        return this->channels.stats(channel);
+    }
+
+    uint64_t Server::get_tick() const {
+        return this->m_tick;
+    }
+
+    /*
+     * Add a packet to the channel's outgoing queue,
+     * applying the channel's queue limit and drop policy.
+     * LatestOnly channels keep at most one packet per destination.
+     */
+    void Server::queue_packet(const Packet& packet, ENetPeer* dest, uint32_t flags, uint8_t channel) {
+        if (channel >= this->m_outgoing_messages.size()) {
+            debug_error("[SERVER] Channel %u does not exist.", channel);
+            return;
+        }
+
+        const ChannelConfig& config = this->channels.config(channel);
+        std::deque<QueuePacket>& queue = this->m_outgoing_messages[channel];
+
+        // Congested peers only get reliable data until they catch up,
+        // and peers about to be kicked get nothing
+        if (dest != nullptr) {
+            auto budget_it = this->m_send_budgets.find(dest);
+            if (budget_it != this->m_send_budgets.end()) {
+                const SendBudget& budget = budget_it->second;
+                if (budget.over_limit || (budget.congested && !(flags & ENET_PACKET_FLAG_RELIABLE))) {
+                    this->channels.record_drop(channel);
+                    return;
+                }
+            }
+        }
+
+        if (config.mode == DeliveryMode::LatestOnly) {
+            for (QueuePacket& message : queue) {
+                if (message.dest == dest) {
+                    track_queued(message, false);
+                    message.packet = packet;
+                    message.flags = flags;
+                    track_queued(message, true);
+                    this->channels.record_drop(channel);
+                    return;
+                }
+            }
+        }
+
+        // The broadcast backlog is the server's problem, not any one
+        // peer's; refuse new broadcasts instead of kicking anyone
+        size_t broadcast_limit = this->backpressure.broadcast_limit;
+        if (dest == nullptr && broadcast_limit > 0
+            && this->m_broadcast_queued + packet.get_size() > broadcast_limit) {
+            debug_warn("[SERVER] Broadcast backlog full, dropping broadcast.");
+            this->channels.record_drop(channel);
+            return;
+        }
+
+        if (config.queue_limit > 0 && queue.size() >= config.queue_limit) {
+            this->channels.record_drop(channel);
+
+            if (config.drop_policy == DropPolicy::DropNewest) {
+                return;
+            }
+            track_queued(queue.front(), false);
+            queue.pop_front();
+        }
+
+        queue.push_back((QueuePacket){
+            .packet = packet,
+            .dest = dest,
+            .flags = flags,
             .channel = channel,
+            .queued_at = get_local_timestamp(),
         });
+        track_queued(queue.back(), true);
+    }
+
+    /*
+     * Account for a packet entering or leaving our queues. Crossing
+     * the hard limit here marks the peer for a kick at the next flush,
+     * before any of its backlog reaches ENet. Broadcasts only count
+     * toward the server-wide broadcast total; once flushed they sit in
+     * each peer's ENet queues, and are charged to the peer from there.
+     */
+    void Server::track_queued(const QueuePacket& message, bool added) {
+        size_t size = message.packet.get_size();
+
+        if (message.dest == nullptr) {
+            if (added) {
+                this->m_broadcast_queued += size;
+            }
+            else {
+                this->m_broadcast_queued -= std::min(this->m_broadcast_queued, size);
+            }
+            return;
+        }
+
+        auto budget_it = this->m_send_budgets.find(message.dest);
+        if (budget_it == this->m_send_budgets.end()) {
+            return;
+        }
+
+        SendBudget& budget = budget_it->second;
+        if (!added) {
+            budget.queued -= std::min(budget.queued, size);
+            return;
+        }
+
+        budget.queued += size;
+        size_t usage = budget.queued + budget.enet_queued + budget.in_transit;
+        if (this->backpressure.hard_limit > 0 && usage > this->backpressure.hard_limit) {
+            budget.over_limit = true;
+        }
+    }
+
+    /*
+     * Refresh every client's send budget from ENet's queues, tell the
+     * game about peers crossing the soft limit and kick peers over the
+     * hard limit. Walking ENet's queues stops at the hard limit, so a
+     * stalled peer costs no more than a healthy one.
+     */
+    void Server::update_send_budgets() {
+        std::vector<ENetPeer*> kicks;
+        std::vector<ENetPeer*> changed;
+
+        for (auto& entry : this->m_send_budgets) {
+            ENetPeer* peer = entry.first;
+            SendBudget& budget = entry.second;
+
+            size_t limit = this->backpressure.hard_limit;
+            budget.in_transit = peer->reliableDataInTransit;
+            budget.enet_queued = 0;
+            budget.enet_queued += outgoing_bytes(&peer->outgoingCommands, limit);
+            budget.enet_queued += outgoing_bytes(&peer->outgoingSendReliableCommands, limit);
+
+            size_t usage = budget.queued + budget.enet_queued + budget.in_transit;
+            if (budget.over_limit || (limit > 0 && usage > limit)) {
+                kicks.push_back(peer);
+                continue;
+            }
+
+            size_t soft_limit = this->backpressure.soft_limit;
+            bool congested = soft_limit > 0 && usage > soft_limit;
+            if (congested != budget.congested) {
+                budget.congested = congested;
+                if (congested) {
+                    this->m_congested_count++;
+                }
+                else {
+                    this->m_congested_count--;
+                }
+                changed.push_back(peer);
+            }
+        }
+
+        for (ENetPeer* peer : kicks) {
+            debug_warn("[SERVER] Client exceeded send limit, kicking.");
+            kick_client(peer, _DISCONNECT_REASON_BACKPRESSURE);
+        }
+
+        // Callbacks last, they may send or change state
+        if (this->m_user_backpressure_callback != nullptr) {
+            for (ENetPeer* peer : changed) {
+                auto budget_it = this->m_send_budgets.find(peer);
+                if (budget_it != this->m_send_budgets.end()) {
+                    this->m_user_backpressure_callback(*this, peer, budget_it->second.congested);
+                }
+            }
+        }
+    }
+
+    /*
+     * Disconnect a client immediately, as if it had left.
+     */
+    void Server::kick_client(ENetPeer* peer, uint32_t reason) {
+        ENetEvent event = {};
+        event.type = ENET_EVENT_TYPE_DISCONNECT;
+        event.peer = peer;
+        event.data = reason;
+
+        if (this->m_user_disconnect_callback != nullptr) {
+            this->m_user_disconnect_callback(*this, event);
+        }
+
+        // Resetting the peer clears its connect ID, so forget it first
+        disconnect_client(event);
+        enet_peer_disconnect_now(peer, reason);
+    }
+
+    PeerSendStats Server::get_send_stats(ENetPeer* peer) const {
+        auto budget_it = this->m_send_budgets.find(peer);
+        if (budget_it == this->m_send_budgets.end()) {
+            return (PeerSendStats){};
+        }
+
+        const SendBudget& budget = budget_it->second;
+        return (PeerSendStats){
+            .queued = budget.queued + budget.enet_queued,
+            .in_transit = budget.in_transit,
+            .congested = budget.congested,
+        };
+    }
+
+    /*
+     * Called with true when a client's unsent and unacknowledged data
+     * crosses backpressure.soft_limit and with false once it drops back
+     * under. Congested clients only receive reliable packets.
+     */
+    void Server::set_backpressure_callback(std::function<void(Server&, ENetPeer*, bool)> callback) {
+        this->m_user_backpressure_callback = callback;
     }
 
     Message* Server::read_packet() {
@@ -273,48 +1343,75 @@ namespace snow {
     }
 
     /*
-     * Send packet directly to client.
+     * Serialize a packet for ENet. Packets on snapshot channels are
+     * stamped with the current tick and its start time, which is
+     * the moment the game state they carry describes.
      */
-    void Server::_send_packet_immediate(const Packet& packet, ENetPeer* dest, bool reliable, uint8_t channel) {
-        size_t flag = 0;
-
-        if (reliable) {
-            flag = ENET_PACKET_FLAG_RELIABLE;
+    ENetPacket* Server::create_enet_packet(const Packet& packet, uint32_t flags, uint8_t channel) const {
+        if (channel >= this->channels.size() || !this->channels.config(channel).snapshots) {
+            return packet.create_enet_packet(flags);
         }
-        else {
-            flag = ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT;
+
+        ENetPacket* enet_packet = packet.create_enet_packet(flags, _SNAPSHOT_STAMP_SIZE);
+        if (enet_packet == nullptr) {
+            return nullptr;
         }
 
-        uint8_t* bytes = packet.serialize();
+        PacketWriter writer(enet_packet->data, _SNAPSHOT_STAMP_SIZE);
+        writer.write_u64(this->m_tick);
+        writer.write_u64(this->m_tick_start);
+        return enet_packet;
+    }
+
+    /*
+     * Send packet directly to client.
+     * Returns the number of bytes handed to ENet.
+     */
+    size_t Server::_send_packet_immediate(const Packet& packet, ENetPeer* dest, uint32_t flags, uint8_t channel) {
         size_t size = packet.get_size();
-        ENetPacket* enet_packet = enet_packet_create(bytes, size, flag);
+        ENetPacket* enet_packet = create_enet_packet(packet, flags, channel);
+        if (enet_packet == nullptr) {
+            return 0;
+        }
 
-        enet_peer_send(dest, channel, enet_packet);
+        if (enet_peer_send(dest, this->channels.enet_channel(channel), enet_packet) < 0) {
+            enet_packet_destroy(enet_packet);
+            return 0;
+        }
 
-        free(bytes);
+        return size;
     }
 
     /*
      * Broadcast packet to all clients.
      */
-    void Server::_broadcast_packet_immediate(const Packet& packet, bool reliable, uint8_t channel) {
-        size_t flag = 0;
-
-        if (reliable) {
-            flag = ENET_PACKET_FLAG_RELIABLE;
-        }
-        else {
-            flag = ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT;
+    size_t Server::_broadcast_packet_immediate(const Packet& packet, uint32_t flags, uint8_t channel) {
+        size_t size = packet.get_size();
+        ENetPacket* enet_packet = create_enet_packet(packet, flags, channel);
+        if (enet_packet == nullptr) {
+            return 0;
         }
 
-        uint8_t* bytes = packet.serialize();
-        size_t size = packet.get_size();
-        ENetPacket* enet_packet = enet_packet_create(bytes, size, flag);
+        bool skip_congested = this->m_congested_count > 0 && !(flags & ENET_PACKET_FLAG_RELIABLE);
 
+        size_t sent = 0;
         for (const ClientInfo& client : this->m_clients) {
-            enet_peer_send(client.peer, channel, enet_packet);
+            if (skip_congested) {
+                auto budget_it = this->m_send_budgets.find(client.peer);
+                if (budget_it != this->m_send_budgets.end() && budget_it->second.congested) {
+                    continue;
+                }
+            }
+            if (enet_peer_send(client.peer, this->channels.enet_channel(channel), enet_packet) == 0) {
+                sent++;
+            }
+        }
+
+        // Nobody took a reference
+        if (enet_packet->referenceCount == 0) {
+            enet_packet_destroy(enet_packet);
         }
 
-        free(bytes);
+        return size * sent;
     }
 }
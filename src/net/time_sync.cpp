@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <cmath>
+
+#include "net/time_sync.h"
+
+namespace snow {
+    namespace {
+        // Samples kept for filtering
+        constexpr size_t sample_window = 16;
+
+        // Samples needed before the estimate is trusted
+        constexpr uint64_t min_samples = 4;
+
+        // Samples with an RTT within this margin (us) of the
+        // window's best are considered equally trustworthy
+        constexpr uint64_t rtt_margin = 1000;
+
+        // Fraction of the remaining error corrected per sample
+        constexpr double smoothing = 0.1;
+
+        // Errors larger than this (us) are applied at once
+        constexpr double snap_threshold = 50000.0;
+
+        // Request intervals (ms) while converging and afterwards
+        constexpr uint32_t fast_interval = 100;
+        constexpr uint32_t slow_interval = 1000;
+    }
+
+    TimeSync::TimeSync() {
+        this->m_samples.resize(sample_window);
+        this->reset();
+    }
+
+    /*
+     * Forget all samples, e.g. after reconnecting.
+     */
+    void TimeSync::reset() {
+        this->m_next_sample = 0;
+        this->m_sample_count = 0;
+        this->m_offset = 0.0;
+        this->m_rtt = 0;
+        this->m_synchronized = false;
+        this->m_tick = 0;
+        this->m_tick_start = 0;
+        this->m_tick_rate = 0;
+    }
+
+    /*
+     * Record one request/response exchange.
+     *   client_send     request left the client (client clock)
+     *   server_receive  request reached the server (server clock)
+     *   server_send     response left the server (server clock)
+     *   client_receive  response reached the client (client clock)
+     */
+    void TimeSync::add_sample(
+        uint64_t client_send,
+        uint64_t server_receive,
+        uint64_t server_send,
+        uint64_t client_receive
+    ) {
+        if (client_receive < client_send || server_send < server_receive) {
+            return;
+        }
+
+        uint64_t round_trip = client_receive - client_send;
+        uint64_t processing = server_send - server_receive;
+
+        TimeSyncSample sample;
+        sample.rtt = (round_trip > processing) ? round_trip - processing : 0;
+        sample.offset = (
+            ((int64_t)server_receive - (int64_t)client_send) +
+            ((int64_t)server_send - (int64_t)client_receive)
+        ) / 2;
+
+        this->m_samples[this->m_next_sample] = sample;
+        this->m_next_sample = (this->m_next_sample + 1) % sample_window;
+        this->m_sample_count++;
+
+        this->update_estimate();
+    }
+
+    /*
+     * Recompute the offset from the lowest-RTT samples in the window.
+     */
+    void TimeSync::update_estimate() {
+        size_t count = (size_t)std::min<uint64_t>(this->m_sample_count, sample_window);
+
+        uint64_t best_rtt = UINT64_MAX;
+        for (size_t i = 0; i < count; i++) {
+            best_rtt = std::min(best_rtt, this->m_samples[i].rtt);
+        }
+
+        std::vector<int64_t> offsets;
+        offsets.reserve(count);
+        for (size_t i = 0; i < count; i++) {
+            if (this->m_samples[i].rtt <= best_rtt + rtt_margin) {
+                offsets.push_back(this->m_samples[i].offset);
+            }
+        }
+
+        size_t middle = offsets.size() / 2;
+        std::nth_element(offsets.begin(), offsets.begin() + middle, offsets.end());
+        double target = (double)offsets[middle];
+
+        if (this->m_sample_count == 1 || std::fabs(target - this->m_offset) > snap_threshold) {
+            this->m_offset = target;
+        }
+        else {
+            this->m_offset += (target - this->m_offset) * smoothing;
+        }
+
+        this->m_rtt = best_rtt;
+        this->m_synchronized = (this->m_sample_count >= min_samples);
+    }
+
+    /*
+     * Server tick number that started at tick_start (server clock).
+     */
+    void TimeSync::set_tick_reference(uint64_t tick, uint64_t tick_start, uint16_t tick_rate) {
+        this->m_tick = tick;
+        this->m_tick_start = tick_start;
+        this->m_tick_rate = tick_rate;
+    }
+
+    bool TimeSync::synchronized() const {
+        return this->m_synchronized;
+    }
+
+    int64_t TimeSync::offset() const {
+        return (int64_t)std::llround(this->m_offset);
+    }
+
+    uint64_t TimeSync::rtt() const {
+        return this->m_rtt;
+    }
+
+    /*
+     * Convert a local get_monotonic_time_us() value to server time.
+     */
+    uint64_t TimeSync::server_time(uint64_t local_time) const {
+        return (uint64_t)((int64_t)local_time + this->offset());
+    }
+
+    /*
+     * Fractional server tick at the given local time.
+     */
+    double TimeSync::server_tick(uint64_t local_time) const {
+        if (this->m_tick_rate == 0) {
+            return 0.0;
+        }
+
+        double elapsed = (double)((int64_t)this->server_time(local_time) - (int64_t)this->m_tick_start);
+        return (double)this->m_tick + elapsed * this->m_tick_rate / 1000000.0;
+    }
+
+    /*
+     * Milliseconds to wait before the next request.
+     */
+    uint32_t TimeSync::request_interval() const {
+        return (this->m_sample_count < sample_window / 2) ? fast_interval : slow_interval;
+    }
+}
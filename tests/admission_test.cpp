@@ -0,0 +1,107 @@
+#include <cstdio>
+#include <cstdlib>
+
+#include "net/admission.h"
+#include "net/control.h"
+
+#include "check.h"
+
+/*
+ * Checks for the admission stage: cookies only validate for the
+ * address and time window they were issued for, carry the connect
+ * mode, and the per-IP token bucket refills at the configured rate
+ * and makes room for new addresses when the table is full.
+ */
+namespace {
+    ENetAddress make_address(uint32_t host, uint16_t port) {
+        ENetAddress address;
+        address.host = host;
+        address.port = port;
+        return address;
+    }
+
+    void test_cookies() {
+        using namespace snow;
+
+        Admission admission;
+        AdmissionConfig config = Admission::defaults();
+        ENetAddress address = make_address(0x0100007F, 40000);
+        uint64_t now = 1000000;
+
+        for (uint32_t mode : {_CONNECT_NEW, _CONNECT_RESUME}) {
+            uint32_t cookie = admission.make_cookie(config, address, mode, now);
+
+            // Never mistaken for a first attempt, and keeps the mode
+            CHECK((cookie & ~_CONNECT_MODE_MASK) != 0);
+            CHECK((cookie & _CONNECT_MODE_MASK) == mode);
+
+            CHECK(admission.check_cookie(config, address, cookie, now));
+            CHECK(admission.check_cookie(config, address, cookie, now + config.handshake_timeout));
+            CHECK(!admission.check_cookie(config, address, cookie, now + 2 * config.handshake_timeout));
+
+            // Bound to the exact source address and mode
+            CHECK(!admission.check_cookie(config, make_address(address.host, address.port + 1), cookie, now));
+            CHECK(!admission.check_cookie(config, make_address(address.host + 1, address.port), cookie, now));
+            CHECK(!admission.check_cookie(config, address, cookie ^ _CONNECT_MODE_MASK, now));
+        }
+
+        // A first attempt never validates
+        CHECK(!admission.check_cookie(config, address, _CONNECT_NEW, now));
+        CHECK(!admission.check_cookie(config, address, _CONNECT_RESUME, now));
+
+        // Another instance has its own key
+        Admission other;
+        uint32_t cookie = admission.make_cookie(config, address, _CONNECT_NEW, now);
+        CHECK(!other.check_cookie(config, address, cookie, now));
+    }
+
+    void test_token_bucket() {
+        using namespace snow;
+
+        Admission admission;
+        AdmissionConfig config = Admission::defaults();
+        config.rate = 2.0f;
+        config.burst = 4.0f;
+        config.max_pending = 8;
+
+        ENetAddress address = make_address(0x0200007F, 40000);
+        uint64_t now = 1000000;
+
+        for (int i = 0; i < 4; i++) {
+            CHECK(admission.admit(config, address, 0, now) == AdmissionResult::Accept);
+        }
+        CHECK(admission.admit(config, address, 0, now) == AdmissionResult::RateLimited);
+
+        // Other ports on the same IP share the bucket, other IPs don't
+        CHECK(admission.admit(config, make_address(address.host, 40001), 0, now) == AdmissionResult::RateLimited);
+        CHECK(admission.admit(config, make_address(0x0300007F, 40000), 0, now) == AdmissionResult::Accept);
+
+        // Two attempts per second come back
+        CHECK(admission.admit(config, address, 0, now + 500) == AdmissionResult::Accept);
+        CHECK(admission.admit(config, address, 0, now + 500) == AdmissionResult::RateLimited);
+
+        CHECK(admission.admit(config, make_address(0x0400007F, 40000), config.max_pending, now) == AdmissionResult::Busy);
+    }
+
+    void test_full_table() {
+        using namespace snow;
+
+        Admission admission;
+        AdmissionConfig config = Admission::defaults();
+        uint64_t now = 1000000;
+
+        // More addresses than there are buckets, none of them refilled
+        // enough to be pruned; new ones still get in
+        for (uint32_t host = 1; host <= 70000; host++) {
+            CHECK(admission.admit(config, make_address(host, 40000), 0, now) == AdmissionResult::Accept);
+        }
+    }
+}
+
+int main() {
+    test_cookies();
+    test_token_bucket();
+    test_full_table();
+
+    return snow_test::check_report("admission");
+}
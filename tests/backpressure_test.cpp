@@ -0,0 +1,128 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "core/utils.h"
+#include "net/client.h"
+#include "net/control.h"
+#include "net/server.h"
+
+#include "check.h"
+
+/*
+ * Queues more broadcast data in one tick than a single client may
+ * have outstanding. The backlog is shared, so nobody is kicked for
+ * it; past the server-wide broadcast limit broadcasts are dropped
+ * instead. Binds UDP port 18461.
+ */
+namespace {
+    constexpr uint16_t port = 18461;
+    constexpr size_t client_count = 2;
+    constexpr size_t payload = 1000;
+
+    void test_broadcast_backlog() {
+        using namespace snow;
+
+        Server server(port, client_count);
+        server.tick_rate = 100;
+        server.backpressure.soft_limit = 0;
+        server.backpressure.hard_limit = 16 * 1024;
+        server.backpressure.broadcast_limit = 48 * 1024;
+
+        Packet packet;
+        packet.size = payload;
+        packet.data = std::make_unique<uint8_t[]>(payload);
+        memset(packet.data.get(), 0x5A, payload);
+
+        std::atomic<bool> ready(false);
+        std::atomic<size_t> connected(0);
+        std::atomic<size_t> kicked(0);
+        std::atomic<int> step(0);
+        std::atomic<uint64_t> dropped(0);
+
+        std::thread server_thread([&]() {
+            server.init();
+            ready = true;
+            server.start(
+                [&](Server& server) {
+                    while (server.read_packet() != nullptr) {}
+
+                    // 32 KiB, twice the hard limit, then 64 KiB,
+                    // more than the broadcast limit allows
+                    if (step == 1 || step == 2) {
+                        size_t count = (step == 1) ? 32 : 64;
+                        uint64_t before = server.get_channel_stats(_CHANNEL_UNRELIABLE).packets_dropped;
+                        for (size_t i = 0; i < count; i++) {
+                            server.broadcast_packet(packet, _CHANNEL_UNRELIABLE);
+                        }
+                        dropped = server.get_channel_stats(_CHANNEL_UNRELIABLE).packets_dropped - before;
+                        step++;
+                    }
+                },
+                [&](Server&, ENetEvent&) {
+                    connected++;
+                    return true;
+                },
+                [&](Server&, ENetEvent& event) {
+                    if (event.data == _DISCONNECT_REASON_BACKPRESSURE) {
+                        kicked++;
+                    }
+                }
+            );
+        });
+        while (!ready) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        std::vector<std::unique_ptr<Client>> clients;
+        for (size_t i = 0; i < client_count; i++) {
+            clients.push_back(std::make_unique<Client>());
+            CHECK(clients.back()->connect_to_server("127.0.0.1", port));
+        }
+
+        auto poll_for = [&clients](uint64_t ms) {
+            uint64_t end = get_local_timestamp() + ms;
+            while (get_local_timestamp() < end) {
+                for (std::unique_ptr<Client>& client : clients) {
+                    client->poll_events([](ENetEvent&) {});
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        };
+
+        uint64_t deadline = get_local_timestamp() + 5000;
+        while (connected < client_count && get_local_timestamp() < deadline) {
+            poll_for(10);
+        }
+        CHECK(connected == client_count);
+
+        step = 1;
+        deadline = get_local_timestamp() + 5000;
+        while (step < 3 && get_local_timestamp() < deadline) {
+            poll_for(10);
+        }
+        CHECK(step == 3);
+
+        // Give the server a few ticks to act on its budgets
+        poll_for(200);
+
+        CHECK(kicked == 0);
+        CHECK(dropped > 0 && dropped < 64);
+        for (std::unique_ptr<Client>& client : clients) {
+            CHECK(client->is_connected());
+        }
+
+        server.stop();
+        server_thread.join();
+    }
+}
+
+int main() {
+    test_broadcast_backlog();
+
+    return snow_test::check_report("backpressure");
+}
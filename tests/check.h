@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+
+/*
+ * Check harness shared by the tests. CHECK records a failure and
+ * keeps going so one run reports every broken property; main()
+ * returns check_report() at the end.
+ */
+namespace snow_test {
+    inline int failures = 0;
+
+    /*
+     * Print the summary for suite and return the exit code.
+     * detail, if given, is appended to either line.
+     */
+    inline int check_report(const char* suite, const char* detail = nullptr) {
+        if (failures > 0) {
+            std::fprintf(stderr, "%d checks failed", failures);
+            if (detail != nullptr) {
+                std::fprintf(stderr, " (%s)", detail);
+            }
+            std::fprintf(stderr, "\n");
+            return EXIT_FAILURE;
+        }
+
+        std::printf("All %s tests passed", suite);
+        if (detail != nullptr) {
+            std::printf(" (%s)", detail);
+        }
+        std::printf("\n");
+        return EXIT_SUCCESS;
+    }
+}
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            snow_test::failures++; \
+        } \
+    } while (0)
@@ -0,0 +1,317 @@
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "core/utils.h"
+#include "core/serialize.h"
+#include "net/packet.h"
+#include "net/packet_io.h"
+
+#include "check.h"
+
+/*
+ * Round-trip property tests for the packet codec and the
+ * serializers in core/. Inputs come from a fixed seed so any
+ * failure reproduces; pass a seed as argv[1] to explore others.
+ */
+namespace {
+    uint64_t rng_state = 0x853C49E6748FEA9BULL;
+
+    uint64_t next_random() {
+        // splitmix64
+        uint64_t z = (rng_state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    std::vector<uint8_t> random_bytes(size_t size) {
+        std::vector<uint8_t> bytes(size);
+        for (uint8_t& byte : bytes) {
+            byte = (uint8_t)next_random();
+        }
+        return bytes;
+    }
+
+    snow::Packet random_packet(size_t size) {
+        snow::Packet packet;
+        std::vector<uint8_t> uuid = random_bytes(snow::_UUID_SIZE);
+        memcpy(packet.uuid.bytes, uuid.data(), snow::_UUID_SIZE);
+
+        packet.size = size;
+        if (size > 0) {
+            std::vector<uint8_t> payload = random_bytes(size);
+            packet.data = std::make_unique<uint8_t[]>(size);
+            memcpy(packet.data.get(), payload.data(), size);
+        }
+        return packet;
+    }
+
+    bool same_packet(const snow::Packet& a, const snow::Packet& b) {
+        if (a.uuid != b.uuid || a.size != b.size) {
+            return false;
+        }
+        return a.size == 0 || memcmp(a.data.get(), b.data.get(), a.size) == 0;
+    }
+
+    void test_packet_round_trip() {
+        using namespace snow;
+
+        // Sizes around every varint length boundary
+        const size_t sizes[] = {0, 1, 2, 63, 127, 128, 129, 1000, 16383, 16384, 16385, 70000};
+
+        for (size_t size : sizes) {
+            Packet packet = random_packet(size);
+
+            std::vector<uint8_t> buffer(packet.get_size());
+            PacketWriter writer(buffer.data(), buffer.size());
+            CHECK(packet.serialize(writer));
+            CHECK(writer.size() == buffer.size());
+
+            uint8_t* legacy = packet.serialize();
+            CHECK(memcmp(legacy, buffer.data(), buffer.size()) == 0);
+            free(legacy);
+
+            PacketView view;
+            CHECK(Packet::parse(buffer.data(), buffer.size(), view));
+            CHECK(same_packet(Packet(view), packet));
+
+            Packet decoded;
+            CHECK(decoded.deserialize(buffer.data(), buffer.size()));
+            CHECK(same_packet(decoded, packet));
+        }
+    }
+
+    void test_packet_rejects_bad_lengths() {
+        using namespace snow;
+
+        for (int round = 0; round < 50; round++) {
+            Packet packet = random_packet(next_random() % 300);
+
+            std::vector<uint8_t> buffer(packet.get_size());
+            PacketWriter writer(buffer.data(), buffer.size());
+            packet.serialize(writer);
+
+            // Every strict prefix is rejected
+            PacketView view;
+            for (size_t length = 0; length < buffer.size(); length++) {
+                CHECK(!Packet::parse(buffer.data(), length, view));
+            }
+
+            // So is trailing data
+            buffer.push_back((uint8_t)next_random());
+            CHECK(!Packet::parse(buffer.data(), buffer.size(), view));
+
+            // A failed deserialize leaves the packet alone
+            Packet untouched = random_packet(8);
+            Packet expected = untouched;
+            CHECK(!untouched.deserialize(buffer.data(), buffer.size()));
+            CHECK(same_packet(untouched, expected));
+        }
+    }
+
+    void test_varint_round_trip() {
+        using namespace snow;
+
+        std::vector<uint64_t> values = {0, 1, 127, 128, 16383, 16384, UINT32_MAX, UINT64_MAX - 1, UINT64_MAX};
+        for (int i = 0; i < 64; i++) {
+            values.push_back((uint64_t)1 << i);
+            values.push_back(((uint64_t)1 << i) - 1);
+        }
+        for (int i = 0; i < 1000; i++) {
+            values.push_back(next_random() >> (next_random() % 64));
+        }
+
+        for (uint64_t value : values) {
+            uint8_t buffer[_VARINT_MAX_SIZE];
+            PacketWriter writer(buffer, sizeof(buffer));
+            CHECK(writer.write_varint(value));
+            CHECK(writer.size() == varint_size(value));
+
+            uint64_t decoded = 0;
+            PacketReader reader(buffer, writer.size());
+            CHECK(reader.read_varint(decoded));
+            CHECK(decoded == value);
+            CHECK(reader.remaining() == 0);
+
+            // Cut short, it must fail
+            PacketReader short_reader(buffer, writer.size() - 1);
+            CHECK(!short_reader.read_varint(decoded));
+        }
+
+        // Padded, non-minimal encodings are rejected
+        const std::vector<std::vector<uint8_t>> padded = {{0x80, 0x00}, {0x81, 0x00}, {0xFF, 0x80, 0x00}};
+        for (const std::vector<uint8_t>& encoding : padded) {
+            uint64_t value = 0;
+            PacketReader padded_reader(encoding.data(), encoding.size());
+            CHECK(!padded_reader.read_varint(value));
+        }
+
+        // More than 64 bits of payload is rejected
+        uint8_t overlong[_VARINT_MAX_SIZE + 1];
+        memset(overlong, 0xFF, sizeof(overlong));
+        overlong[_VARINT_MAX_SIZE] = 0x01;
+        uint64_t decoded = 0;
+        PacketReader reader(overlong, sizeof(overlong));
+        CHECK(!reader.read_varint(decoded));
+    }
+
+    void test_fixed_width_round_trip() {
+        using namespace snow;
+
+        for (int round = 0; round < 1000; round++) {
+            uint64_t bits = next_random();
+            uint32_t float_bits = (uint32_t)(bits >> 32);
+            float value;
+            memcpy(&value, &float_bits, sizeof(float));
+
+            std::vector<uint8_t> uuid_bytes = random_bytes(_UUID_SIZE);
+            Uuid uuid;
+            memcpy(uuid.bytes, uuid_bytes.data(), _UUID_SIZE);
+
+            uint8_t buffer[64];
+            PacketWriter writer(buffer, sizeof(buffer));
+            writer.write_u8((uint8_t)bits);
+            writer.write_u16((uint16_t)bits);
+            writer.write_u32((uint32_t)bits);
+            writer.write_u64(bits);
+            writer.write_float(value);
+            writer.write_uuid(uuid);
+            CHECK(writer.ok());
+
+            uint8_t u8 = 0;
+            uint16_t u16 = 0;
+            uint32_t u32 = 0;
+            uint64_t u64 = 0;
+            float f = 0.0f;
+            Uuid decoded_uuid;
+
+            PacketReader reader(buffer, writer.size());
+            reader.read_u8(u8);
+            reader.read_u16(u16);
+            reader.read_u32(u32);
+            reader.read_u64(u64);
+            reader.read_float(f);
+            reader.read_uuid(decoded_uuid);
+            CHECK(reader.ok());
+            CHECK(reader.remaining() == 0);
+
+            CHECK(u8 == (uint8_t)bits);
+            CHECK(u16 == (uint16_t)bits);
+            CHECK(u32 == (uint32_t)bits);
+            CHECK(u64 == bits);
+            CHECK(memcmp(&f, &value, sizeof(float)) == 0);
+            CHECK(decoded_uuid == uuid);
+
+            // Reading past the end fails and stays failed
+            CHECK(!reader.read_u8(u8));
+            CHECK(!reader.ok());
+
+            // Writing past the end fails too
+            PacketWriter full(buffer, 3);
+            CHECK(!full.write_u32((uint32_t)bits));
+            CHECK(!full.write_u8(0));
+        }
+    }
+
+    void test_utils_serializers() {
+        using namespace snow;
+
+        uint8_t buffer[16];
+        for (int round = 0; round < 1000; round++) {
+            uint64_t value = next_random();
+            size_t offset = value % 8;
+
+            // Unaligned on purpose
+            serialize_uint64_t(buffer + offset, value);
+            CHECK(deserialize_uint64_t(buffer + offset) == value);
+            CHECK(buffer[offset] == (uint8_t)(value >> 56));
+            CHECK(ntohll(htonll(value)) == value);
+
+            uint32_t float_bits = (uint32_t)value;
+            float f;
+            memcpy(&f, &float_bits, sizeof(float));
+            serialize_float(buffer + offset, f);
+            float decoded = deserialize_float(buffer + offset);
+            CHECK(memcmp(&decoded, &f, sizeof(float)) == 0);
+        }
+    }
+
+    void test_bulk_matches_scalar() {
+        using namespace snow;
+
+        for (size_t count = 0; count < 70; count++) {
+            std::vector<uint64_t> u64s(count);
+            std::vector<uint32_t> u32s(count);
+            std::vector<float> floats(count);
+            for (size_t i = 0; i < count; i++) {
+                u64s[i] = next_random();
+                u32s[i] = (uint32_t)next_random();
+                floats[i] = (float)((int64_t)next_random() % 100000) * 0.01f;
+            }
+
+            // One byte in, so the kernels see unaligned buffers
+            std::vector<uint8_t> bulk(count * sizeof(uint64_t) + 1);
+            std::vector<uint8_t> scalar(count * sizeof(uint64_t));
+            PacketWriter writer(scalar.data(), scalar.size());
+
+            serialize_u64s(bulk.data() + 1, u64s.data(), count);
+            for (uint64_t value : u64s) {
+                writer.write_u64(value);
+            }
+            CHECK(count == 0 || memcmp(bulk.data() + 1, scalar.data(), scalar.size()) == 0);
+
+            std::vector<uint64_t> decoded_u64s(count);
+            deserialize_u64s(bulk.data() + 1, decoded_u64s.data(), count);
+            CHECK(decoded_u64s == u64s);
+
+            serialize_u32s(bulk.data() + 1, u32s.data(), count);
+            std::vector<uint32_t> decoded_u32s(count);
+            deserialize_u32s(bulk.data() + 1, decoded_u32s.data(), count);
+            CHECK(decoded_u32s == u32s);
+
+            serialize_floats(bulk.data() + 1, floats.data(), count);
+            PacketReader reader(bulk.data() + 1, count * sizeof(float));
+            std::vector<float> decoded_floats(count);
+            CHECK(reader.read_floats(decoded_floats.data(), count));
+            CHECK(decoded_floats == floats);
+        }
+    }
+
+    void test_quantization_bounds() {
+        using namespace snow;
+
+        for (int round = 0; round < 1000; round++) {
+            uint32_t bits = 1 + next_random() % 24;
+            float value = (float)(next_random() % 2001) / 10.0f - 100.0f;
+
+            float step = 200.0f / (float)((1u << bits) - 1);
+            float decoded = dequantize_float(quantize_float(value, -100.0f, 100.0f, bits), -100.0f, 100.0f, bits);
+            CHECK(std::fabs(decoded - value) <= step * 0.5f + 1e-4f);
+
+            // Halves hold small integers exactly
+            float whole = (float)((int)(next_random() % 4096) - 2048);
+            CHECK(half_to_float(float_to_half(whole)) == whole);
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1) {
+        rng_state = strtoull(argv[1], nullptr, 0);
+    }
+
+    test_packet_round_trip();
+    test_packet_rejects_bad_lengths();
+    test_varint_round_trip();
+    test_fixed_width_round_trip();
+    test_utils_serializers();
+    test_bulk_matches_scalar();
+    test_quantization_bounds();
+
+    std::string kernels = std::string(snow::serialize_kernel_name()) + " kernels";
+    return snow_test::check_report("codec", kernels.c_str());
+}
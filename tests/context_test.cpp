@@ -0,0 +1,145 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "net/context.h"
+#include "net/server.h"
+
+#include "check.h"
+
+/*
+ * Exercises the Context threading contract: several Servers created
+ * and destroyed on different threads, ticked by a shared pool, each
+ * only ever on one thread at a time, with ENet's reference count
+ * returning to zero once everything is gone. Best run under
+ * -fsanitize=thread as well.
+ */
+namespace {
+    constexpr uint16_t base_port = 18441;
+    constexpr size_t server_count = 4;
+
+    typedef struct {
+        std::atomic<int> in_loop;
+        std::atomic<uint64_t> ticks;
+        std::atomic<bool> overlapped;
+    } TickRecord;
+
+    void test_servers_on_pool() {
+        using namespace snow;
+
+        CHECK(Context::enet_reference_count() == 0);
+
+        std::vector<std::unique_ptr<Server>> servers(server_count);
+        std::vector<std::unique_ptr<TickRecord>> records(server_count);
+
+        {
+            Context context(2);
+            CHECK(Context::enet_reference_count() == 1);
+
+            // Servers are created and initialized on their own threads
+            std::vector<std::thread> threads;
+            for (size_t i = 0; i < server_count; i++) {
+                threads.emplace_back([&servers, i]() {
+                    servers[i] = std::make_unique<Server>(base_port + i, 4);
+                    servers[i]->tick_rate = 100;
+                    servers[i]->init();
+                });
+            }
+            for (std::thread& thread : threads) {
+                thread.join();
+            }
+            CHECK(Context::enet_reference_count() == 1 + server_count);
+
+            for (size_t i = 0; i < server_count; i++) {
+                records[i] = std::make_unique<TickRecord>();
+                TickRecord* record = records[i].get();
+                record->in_loop = 0;
+                record->ticks = 0;
+                record->overlapped = false;
+
+                context.add_server(*servers[i], [record, i](Server& server) {
+                    if (record->in_loop.fetch_add(1) != 0) {
+                        record->overlapped = true;
+                    }
+                    record->ticks++;
+
+                    // The first server leaves the pool on its own
+                    if (i == 0 && server.get_tick() >= 10) {
+                        server.stop();
+                    }
+
+                    std::this_thread::sleep_for(std::chrono::microseconds(200));
+                    record->in_loop--;
+                });
+            }
+            CHECK(context.server_count() == server_count);
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(400));
+
+            // The stopped server was dropped by the pool
+            CHECK(context.server_count() == server_count - 1);
+
+            for (size_t i = 0; i < server_count; i++) {
+                context.remove_server(*servers[i]);
+            }
+            CHECK(context.server_count() == 0);
+
+            for (size_t i = 0; i < server_count; i++) {
+                CHECK(records[i]->ticks > 0);
+                CHECK(!records[i]->overlapped);
+            }
+            CHECK(records[0]->ticks == 10);
+            CHECK(records[1]->ticks > records[0]->ticks);
+
+            // Removed servers belong to whoever takes them; tear
+            // them down on other threads while the Context lives on
+            threads.clear();
+            for (size_t i = 0; i < server_count; i++) {
+                threads.emplace_back([&servers, i]() {
+                    servers[i].reset();
+                });
+            }
+            for (std::thread& thread : threads) {
+                thread.join();
+            }
+            CHECK(Context::enet_reference_count() == 1);
+        }
+
+        CHECK(Context::enet_reference_count() == 0);
+    }
+
+    void test_enet_reacquire() {
+        using namespace snow;
+
+        // Torn down and brought back up again
+        CHECK(Context::acquire_enet());
+        CHECK(Context::acquire_enet());
+        CHECK(Context::enet_reference_count() == 2);
+
+        Context::release_enet();
+        Context::release_enet();
+        CHECK(Context::enet_reference_count() == 0);
+
+        // Too many releases don't wrap around
+        Context::release_enet();
+        CHECK(Context::enet_reference_count() == 0);
+
+        {
+            Server server(base_port, 4);
+            server.init();
+            CHECK(Context::enet_reference_count() == 1);
+        }
+        CHECK(Context::enet_reference_count() == 0);
+    }
+}
+
+int main() {
+    test_servers_on_pool();
+    test_enet_reacquire();
+
+    return snow_test::check_report("context");
+}
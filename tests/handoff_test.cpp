@@ -0,0 +1,162 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "core/utils.h"
+#include "net/client.h"
+#include "net/handoff.h"
+#include "net/server.h"
+
+#include "check.h"
+
+/*
+ * Checks the handoff message over a socketpair (client table with
+ * resume secrets, user state and the UDP socket itself), then a full
+ * restart: a client connected to one Server moves to its replacement
+ * and gets its UUID back. Binds UDP port 18451 and a unix socket in
+ * the working directory.
+ */
+namespace {
+    constexpr uint16_t port = 18451;
+    constexpr const char* handoff_path = "handoff_test.sock";
+
+    uint16_t bound_port(int fd) {
+        sockaddr_in address = {};
+        socklen_t length = sizeof(address);
+        getsockname(fd, (sockaddr*)&address, &length);
+        return ntohs(address.sin_port);
+    }
+
+    void test_message_round_trip() {
+        using namespace snow;
+
+        int pair[2];
+        CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0);
+
+        int udp = socket(AF_INET, SOCK_DGRAM, 0);
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        CHECK(bind(udp, (sockaddr*)&address, sizeof(address)) == 0);
+
+        HandoffState sent;
+        sent.socket = udp;
+        sent.user_state = {1, 2, 3, 4, 5};
+        for (uint32_t i = 0; i < 3; i++) {
+            HandoffClient client;
+            client.uuid = generate_uuid();
+            fill_secure_random(client.secret.bytes, sizeof(client.secret.bytes));
+            client.address.host = htonl(0x7F000001 + i);
+            client.address.port = (uint16_t)(40000 + i);
+            sent.clients.push_back(client);
+        }
+        CHECK(write_handoff(pair[0], sent));
+
+        HandoffState received;
+        CHECK(read_handoff(pair[1], received, 1000));
+        CHECK(received.user_state == sent.user_state);
+        CHECK(received.clients.size() == sent.clients.size());
+        for (size_t i = 0; i < received.clients.size() && i < sent.clients.size(); i++) {
+            CHECK(received.clients[i].uuid == sent.clients[i].uuid);
+            CHECK(received.clients[i].secret == sent.clients[i].secret);
+            CHECK(received.clients[i].address.host == sent.clients[i].address.host);
+            CHECK(received.clients[i].address.port == sent.clients[i].address.port);
+        }
+
+        // A new descriptor for the same socket
+        CHECK(received.socket >= 0 && received.socket != udp);
+        CHECK(bound_port(received.socket) == bound_port(udp));
+        close(received.socket);
+
+        // Nothing more to read once the sender is gone
+        close(pair[0]);
+        CHECK(!read_handoff(pair[1], received, 100));
+
+        close(pair[1]);
+        close(udp);
+    }
+
+    void test_resume_after_restart() {
+        using namespace snow;
+
+        Server old_server(port, 4);
+        old_server.tick_rate = 100;
+        std::atomic<bool> old_ready(false);
+        std::atomic<bool> handed_off(false);
+        std::atomic<bool> old_done(false);
+
+        std::thread old_thread([&]() {
+            old_server.init();
+            old_ready = true;
+            old_server.start([](Server& server) {
+                while (server.read_packet() != nullptr) {}
+            });
+            handed_off = old_server.handoff(handoff_path, 5000, {7, 8, 9});
+            old_done = true;
+        });
+        while (!old_ready) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        Client client;
+        CHECK(client.connect_to_server("127.0.0.1", port));
+        Uuid uuid = client.get_uuid();
+        CHECK(!uuid.is_nil());
+
+        Server new_server(port, 4);
+        new_server.tick_rate = 100;
+        std::atomic<bool> took_over(false);
+        std::atomic<bool> new_done(false);
+
+        std::thread new_thread([&]() {
+            took_over = new_server.init_from_handoff(handoff_path, 5000);
+            new_done = true;
+            if (took_over) {
+                new_server.start([](Server& server) {
+                    while (server.read_packet() != nullptr) {}
+                });
+            }
+        });
+
+        // The client has to keep answering while the old server
+        // tells it to move, then reconnect on its own
+        old_server.stop();
+        bool reconnecting = false;
+        uint64_t deadline = get_local_timestamp() + 10000;
+        while (get_local_timestamp() < deadline) {
+            client.poll_events([](ENetEvent&) {});
+            reconnecting = reconnecting || client.is_connecting();
+            if (old_done && new_done && reconnecting && client.is_connected()) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+
+        CHECK(handed_off);
+        CHECK(took_over);
+        CHECK(reconnecting);
+        CHECK(client.is_connected());
+        CHECK(client.get_uuid() == uuid);
+        CHECK(new_server.get_handoff_state() == std::vector<uint8_t>({7, 8, 9}));
+
+        new_server.stop();
+        old_thread.join();
+        new_thread.join();
+    }
+}
+
+int main() {
+    test_message_round_trip();
+    test_resume_after_restart();
+
+    return snow_test::check_report("handoff");
+}
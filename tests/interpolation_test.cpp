@@ -0,0 +1,163 @@
+#include <cstdint>
+#include <memory>
+
+#include "net/interpolation.h"
+#include "net/packet.h"
+
+#include "check.h"
+
+/*
+ * Checks for SnapshotBuffer: snapshots come out in time order,
+ * duplicates and hopelessly late ones are dropped, sampling past the
+ * newest extrapolates, and the render delay grows quickly with jitter
+ * but shrinks slowly once it is gone.
+ */
+namespace {
+    constexpr uint64_t interval = 50000;
+
+    snow::Packet make_packet(uint8_t id) {
+        snow::Packet packet;
+        packet.size = 1;
+        packet.data = std::make_unique<uint8_t[]>(1);
+        packet.data[0] = id;
+        return packet;
+    }
+
+    uint8_t packet_id(const snow::Snapshot* snapshot) {
+        return snapshot->packet.data[0];
+    }
+
+    void test_ordering() {
+        using namespace snow;
+
+        SnapshotBuffer buffer;
+        buffer.push(300, make_packet(3), 310, 3);
+        buffer.push(100, make_packet(1), 320, 1);
+        buffer.push(200, make_packet(2), 330, 2);
+        CHECK(buffer.size() == 3);
+
+        SnapshotSample sample;
+        CHECK(buffer.sample(150, sample));
+        CHECK(sample.from->time == 100 && sample.to->time == 200);
+        CHECK(sample.from->tick == 1 && sample.to->tick == 2);
+        CHECK(sample.alpha == 0.5f);
+        CHECK(!sample.extrapolating);
+
+        CHECK(buffer.sample(250, sample));
+        CHECK(packet_id(sample.from) == 2 && packet_id(sample.to) == 3);
+
+        // A second copy of a snapshot is ignored
+        buffer.push(200, make_packet(9), 340, 2);
+        CHECK(buffer.size() == 3);
+        CHECK(buffer.sample(200, sample));
+        CHECK(packet_id(sample.to) == 2);
+
+        buffer.clear();
+        CHECK(buffer.size() == 0);
+        CHECK(!buffer.sample(200, sample));
+    }
+
+    void test_late_drops() {
+        using namespace snow;
+
+        SnapshotBuffer buffer(4);
+        for (uint8_t i = 1; i <= 4; i++) {
+            buffer.push(i * 100, make_packet(i), i * 100 + 10);
+        }
+
+        // Older than everything in a full buffer
+        buffer.push(50, make_packet(0), 500);
+        CHECK(buffer.size() == 4);
+
+        SnapshotSample sample;
+        CHECK(buffer.sample(0, sample));
+        CHECK(sample.from->time == 100);
+
+        // Newer ones push the oldest out, late ones still fit in
+        buffer.push(500, make_packet(5), 510);
+        buffer.push(250, make_packet(6), 520);
+        CHECK(buffer.size() == 4);
+        CHECK(buffer.sample(0, sample));
+        CHECK(sample.from->time == 250);
+        CHECK(buffer.sample(275, sample));
+        CHECK(sample.from->time == 250 && sample.to->time == 300);
+    }
+
+    void test_extrapolation() {
+        using namespace snow;
+
+        SnapshotBuffer buffer;
+        buffer.push(100, make_packet(1), 110);
+        buffer.push(200, make_packet(2), 210);
+
+        SnapshotSample sample;
+        CHECK(buffer.sample(150, sample));
+        CHECK(!sample.extrapolating);
+        CHECK(buffer.get_extrapolation_rate() == 0.0);
+
+        CHECK(buffer.sample(300, sample));
+        CHECK(sample.extrapolating);
+        CHECK(sample.from->time == 100 && sample.to->time == 200);
+        CHECK(sample.alpha == 2.0f);
+        CHECK(buffer.get_extrapolation_rate() == 0.5);
+
+        // Before the oldest there is nothing to blend from
+        CHECK(buffer.sample(50, sample));
+        CHECK(sample.from == sample.to);
+        CHECK(sample.alpha == 0.0f);
+        CHECK(!sample.extrapolating);
+    }
+
+    void test_render_delay() {
+        using namespace snow;
+
+        SnapshotBuffer buffer;
+        uint64_t time = 1000000;
+
+        // Steady arrivals 20 ms after the server sent them
+        for (int i = 0; i < 100; i++) {
+            buffer.push(time, make_packet(0), time + 20000);
+            time += interval;
+        }
+        CHECK(buffer.get_interval() == interval);
+        CHECK(buffer.get_render_delay() > interval + 19000);
+        CHECK(buffer.get_render_delay() < interval + 21000);
+        CHECK(buffer.render_time(time) == time - buffer.get_render_delay());
+
+        // A burst of 120 ms delays is covered within a few snapshots
+        for (int i = 0; i < 10; i++) {
+            buffer.push(time, make_packet(0), time + 120000);
+            time += interval;
+        }
+        CHECK(buffer.get_render_delay() > interval + 90000);
+
+        // Once it is over, the delay comes back down only slowly
+        for (int i = 0; i < 64; i++) {
+            buffer.push(time, make_packet(0), time + 20000);
+            time += interval;
+        }
+        uint64_t shrinking = buffer.get_render_delay();
+        CHECK(shrinking > interval + 70000);
+
+        for (int i = 0; i < 300; i++) {
+            buffer.push(time, make_packet(0), time + 20000);
+            time += interval;
+        }
+        CHECK(buffer.get_render_delay() < shrinking);
+        CHECK(buffer.get_render_delay() < interval + 21000);
+
+        // Never below the configured floor
+        buffer.min_delay = 200000;
+        buffer.push(time, make_packet(0), time + 20000);
+        CHECK(buffer.get_render_delay() > interval + 20000);
+    }
+}
+
+int main() {
+    test_ordering();
+    test_late_drops();
+    test_extrapolation();
+    test_render_delay();
+
+    return snow_test::check_report("interpolation");
+}
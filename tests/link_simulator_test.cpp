@@ -0,0 +1,244 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "enet/enet.h"
+
+#include "core/utils.h"
+#include "net/link_simulator.h"
+
+#include "check.h"
+
+/*
+ * Drives a LinkSimulator over loopback with plain UDP sockets on
+ * both ends and checks that delay, loss and queue drops behave as
+ * configured. Timing checks only bound from below, plus a generous
+ * ceiling, so a loaded machine does not make them flaky.
+ */
+namespace {
+    constexpr uint16_t simulator_port = 18431;
+    constexpr uint16_t server_port = 18432;
+
+    typedef struct {
+        ENetSocket client;
+        ENetSocket server;
+        ENetAddress simulator_address;
+    } Endpoints;
+
+    ENetSocket open_socket(uint16_t port) {
+        ENetSocket socket = enet_socket_create(ENET_SOCKET_TYPE_DATAGRAM);
+        if (socket == ENET_SOCKET_NULL) {
+            return socket;
+        }
+        enet_socket_set_option(socket, ENET_SOCKOPT_NONBLOCK, 1);
+
+        ENetAddress address;
+        address.host = ENET_HOST_ANY;
+        address.port = port;
+        if (enet_socket_bind(socket, &address) < 0) {
+            enet_socket_destroy(socket);
+            return ENET_SOCKET_NULL;
+        }
+        return socket;
+    }
+
+    bool open_endpoints(Endpoints& endpoints) {
+        endpoints.client = open_socket(0);
+        endpoints.server = open_socket(server_port);
+        enet_address_set_host(&endpoints.simulator_address, "127.0.0.1");
+        endpoints.simulator_address.port = simulator_port;
+        return endpoints.client != ENET_SOCKET_NULL && endpoints.server != ENET_SOCKET_NULL;
+    }
+
+    void close_endpoints(Endpoints& endpoints) {
+        if (endpoints.client != ENET_SOCKET_NULL) enet_socket_destroy(endpoints.client);
+        if (endpoints.server != ENET_SOCKET_NULL) enet_socket_destroy(endpoints.server);
+    }
+
+    void send_datagram(Endpoints& endpoints, size_t size, uint32_t sequence) {
+        std::vector<uint8_t> data(size, 0);
+        memcpy(data.data(), &sequence, std::min(size, sizeof(sequence)));
+
+        ENetBuffer buffer;
+        buffer.data = data.data();
+        buffer.dataLength = data.size();
+        enet_socket_send(endpoints.client, &endpoints.simulator_address, &buffer, 1);
+    }
+
+    /*
+     * Datagrams the server socket has received so far.
+     */
+    uint32_t drain_server(Endpoints& endpoints) {
+        uint8_t data[4096];
+        uint32_t count = 0;
+
+        while (1) {
+            ENetAddress sender;
+            ENetBuffer buffer;
+            buffer.data = data;
+            buffer.dataLength = sizeof(data);
+            if (enet_socket_receive(endpoints.server, &sender, &buffer, 1) <= 0) {
+                break;
+            }
+            count++;
+        }
+        return count;
+    }
+
+    /*
+     * Pump the simulator for duration milliseconds, counting arrivals.
+     * first_arrival is set to when the first datagram showed up (us).
+     */
+    uint32_t pump(snow::LinkSimulator& simulator, Endpoints& endpoints, uint32_t duration, uint64_t* first_arrival = nullptr) {
+        uint64_t end = snow::get_monotonic_time_us() + (uint64_t)duration * 1000;
+        uint32_t received = 0;
+
+        while (snow::get_monotonic_time_us() < end) {
+            simulator.service(1);
+            uint32_t count = drain_server(endpoints);
+            if (count > 0 && received == 0 && first_arrival != nullptr) {
+                *first_arrival = snow::get_monotonic_time_us();
+            }
+            received += count;
+        }
+        return received;
+    }
+
+    void test_latency() {
+        using namespace snow;
+
+        Endpoints endpoints;
+        CHECK(open_endpoints(endpoints));
+
+        LinkConditions conditions = {};
+        conditions.latency = 50;
+
+        LinkSimulator simulator(simulator_port, "127.0.0.1", server_port, 1);
+        CHECK(simulator.init());
+        simulator.set_default_conditions(conditions, conditions);
+
+        uint64_t sent_at = get_monotonic_time_us();
+        send_datagram(endpoints, 100, 0);
+
+        uint64_t arrived_at = 0;
+        uint32_t received = pump(simulator, endpoints, 300, &arrived_at);
+
+        CHECK(received == 1);
+        CHECK(arrived_at - sent_at >= 50 * 1000);
+        CHECK(arrived_at - sent_at < 250 * 1000);
+        CHECK(simulator.get_stats().packets_forwarded == 1);
+        CHECK(simulator.get_stats().packets_dropped == 0);
+
+        close_endpoints(endpoints);
+    }
+
+    void test_loss() {
+        using namespace snow;
+
+        Endpoints endpoints;
+        CHECK(open_endpoints(endpoints));
+
+        LinkConditions conditions = {};
+        conditions.loss = 0.5f;
+
+        LinkSimulator simulator(simulator_port, "127.0.0.1", server_port, 7);
+        CHECK(simulator.init());
+        simulator.set_default_conditions(conditions, conditions);
+
+        // Small batches so neither socket buffer overflows
+        const uint32_t total = 1000;
+        uint32_t received = 0;
+        for (uint32_t i = 0; i < total; i += 50) {
+            for (uint32_t j = 0; j < 50; j++) {
+                send_datagram(endpoints, 32, i + j);
+            }
+            received += pump(simulator, endpoints, 5);
+        }
+        received += pump(simulator, endpoints, 50);
+
+        const LinkStats& stats = simulator.get_stats();
+        CHECK(stats.packets_dropped + stats.packets_forwarded == total);
+        CHECK(received == stats.packets_forwarded);
+        CHECK(stats.packets_dropped > 400 && stats.packets_dropped < 600);
+
+        close_endpoints(endpoints);
+    }
+
+    void test_queue_limit() {
+        using namespace snow;
+
+        Endpoints endpoints;
+        CHECK(open_endpoints(endpoints));
+
+        // 100 KB/s with room for ten 100 byte datagrams behind the link
+        LinkConditions conditions = {};
+        conditions.bandwidth = 100000;
+        conditions.queue_limit = 1000;
+
+        LinkSimulator simulator(simulator_port, "127.0.0.1", server_port, 3);
+        CHECK(simulator.init());
+        simulator.set_default_conditions(conditions, conditions);
+
+        // A burst far faster than the link drains: the tail is dropped
+        for (uint32_t i = 0; i < 40; i++) {
+            send_datagram(endpoints, 100, i);
+        }
+        uint32_t received = pump(simulator, endpoints, 100);
+
+        const LinkStats& stats = simulator.get_stats();
+        CHECK(stats.packets_dropped + stats.packets_forwarded == 40);
+        CHECK(stats.packets_dropped >= 20);
+        CHECK(stats.packets_forwarded >= 10);
+        CHECK(received == stats.packets_forwarded);
+
+        close_endpoints(endpoints);
+    }
+
+    void test_latency_does_not_fill_queue() {
+        using namespace snow;
+
+        Endpoints endpoints;
+        CHECK(open_endpoints(endpoints));
+
+        // Each datagram serializes in 100 us, long before the next one
+        // arrives; thousands of bytes sit in the latency stage at once.
+        LinkConditions conditions = {};
+        conditions.latency = 200;
+        conditions.bandwidth = 1000000;
+        conditions.queue_limit = 500;
+
+        LinkSimulator simulator(simulator_port, "127.0.0.1", server_port, 5);
+        CHECK(simulator.init());
+        simulator.set_default_conditions(conditions, conditions);
+
+        for (uint32_t i = 0; i < 30; i++) {
+            send_datagram(endpoints, 100, i);
+            pump(simulator, endpoints, 2);
+        }
+        pump(simulator, endpoints, 400);
+
+        const LinkStats& stats = simulator.get_stats();
+        CHECK(stats.packets_dropped == 0);
+        CHECK(stats.packets_forwarded == 30);
+
+        close_endpoints(endpoints);
+    }
+}
+
+int main() {
+    if (enet_initialize() != 0) {
+        std::fprintf(stderr, "Failed to initialize ENet\n");
+        return EXIT_FAILURE;
+    }
+
+    test_latency();
+    test_loss();
+    test_queue_limit();
+    test_latency_does_not_fill_queue();
+
+    enet_deinitialize();
+
+    return snow_test::check_report("link simulator");
+}
@@ -0,0 +1,174 @@
+#include <cmath>
+#include <cstdint>
+
+#include "net/time_sync.h"
+
+#include "check.h"
+
+/*
+ * Feeds TimeSync synthetic exchanges with a known clock offset and
+ * checks the filter: low-RTT samples win over asymmetric outliers,
+ * small errors are smoothed, large ones snap, and the tick estimate
+ * follows the server's tick reference.
+ */
+namespace {
+    // Server clock minus client clock
+    constexpr int64_t true_offset = 5000000;
+
+    // Time the server holds each request
+    constexpr uint64_t processing = 200;
+
+    /*
+     * One exchange starting at client time t, taking uplink and
+     * downlink microseconds each way, against a server whose clock
+     * is offset ahead of ours.
+     */
+    void exchange(snow::TimeSync& sync, uint64_t t, uint64_t uplink, uint64_t downlink, int64_t offset = true_offset) {
+        uint64_t server_receive = (uint64_t)((int64_t)(t + uplink) + offset);
+        uint64_t server_send = server_receive + processing;
+        uint64_t client_receive = t + uplink + processing + downlink;
+        sync.add_sample(t, server_receive, server_send, client_receive);
+    }
+
+    void test_converges() {
+        using namespace snow;
+
+        TimeSync sync;
+        CHECK(!sync.synchronized());
+        CHECK(sync.rtt() == 0);
+        CHECK(sync.server_tick(1000) == 0.0);
+
+        uint64_t t = 1000000;
+        for (int i = 0; i < 3; i++) {
+            exchange(sync, t, 10000, 10000);
+            t += 100000;
+        }
+        CHECK(!sync.synchronized());
+
+        exchange(sync, t, 10000, 10000);
+        CHECK(sync.synchronized());
+        CHECK(sync.offset() == true_offset);
+        CHECK(sync.rtt() == 20000);
+        CHECK(sync.server_time(t) == t + true_offset);
+
+        // Responses that arrive before they were sent are ignored
+        sync.add_sample(t + 10, t + true_offset, t + true_offset + processing, t);
+        CHECK(sync.offset() == true_offset);
+        CHECK(sync.rtt() == 20000);
+
+        sync.reset();
+        CHECK(!sync.synchronized());
+        CHECK(sync.rtt() == 0);
+    }
+
+    void test_rejects_asymmetric_outliers() {
+        using namespace snow;
+
+        TimeSync sync;
+        uint64_t t = 1000000;
+
+        // Mostly queued uplinks, which skew the offset by half the
+        // extra delay, around a few clean exchanges
+        for (int i = 0; i < 16; i++) {
+            if (i % 4 == 0) {
+                exchange(sync, t, 10000, 10000);
+            }
+            else {
+                exchange(sync, t, 10000 + 30000 + i * 1000, 10000);
+            }
+            t += 100000;
+        }
+
+        CHECK(sync.synchronized());
+        CHECK(sync.rtt() == 20000);
+        CHECK(sync.offset() == true_offset);
+
+        // Jitter within the RTT margin goes through the median
+        const int64_t jitter[] = {-300, 400, 100, -50, 250, -400, 0};
+        for (int64_t error : jitter) {
+            exchange(sync, t, 10000, 10000, true_offset + error);
+            t += 100000;
+        }
+        CHECK(std::llabs(sync.offset() - true_offset) <= 400);
+    }
+
+    void test_smooths_and_snaps() {
+        using namespace snow;
+
+        TimeSync sync;
+        uint64_t t = 1000000;
+        for (int i = 0; i < 16; i++) {
+            exchange(sync, t, 5000, 5000);
+            t += 100000;
+        }
+        CHECK(sync.offset() == true_offset);
+
+        // A small drift is corrected gradually once it is the median
+        const int64_t drift = 20000;
+        for (int i = 0; i < 9; i++) {
+            exchange(sync, t, 5000, 5000, true_offset + drift);
+            t += 100000;
+        }
+        CHECK(sync.offset() > true_offset);
+        CHECK(sync.offset() < true_offset + drift);
+
+        for (int i = 0; i < 200; i++) {
+            exchange(sync, t, 5000, 5000, true_offset + drift);
+            t += 100000;
+        }
+        CHECK(std::llabs(sync.offset() - (true_offset + drift)) <= 1);
+
+        // A step larger than the snap threshold is taken at once
+        const int64_t step = 1000000;
+        for (int i = 0; i < 9; i++) {
+            exchange(sync, t, 5000, 5000, true_offset + step);
+            t += 100000;
+        }
+        CHECK(sync.offset() == true_offset + step);
+    }
+
+    void test_server_tick() {
+        using namespace snow;
+
+        TimeSync sync;
+        uint64_t t = 1000000;
+        for (int i = 0; i < 4; i++) {
+            exchange(sync, t, 1000, 1000);
+            t += 100000;
+        }
+
+        // Tick 100 started at server time t + offset, 20 ticks per second
+        uint64_t tick_start = t + true_offset;
+        sync.set_tick_reference(100, tick_start, 20);
+        CHECK(std::fabs(sync.server_tick(t) - 100.0) < 1e-9);
+        CHECK(std::fabs(sync.server_tick(t + 125000) - 102.5) < 1e-9);
+        CHECK(std::fabs(sync.server_tick(t - 50000) - 99.0) < 1e-9);
+    }
+
+    void test_request_interval() {
+        using namespace snow;
+
+        TimeSync sync;
+        uint32_t fast = sync.request_interval();
+
+        uint64_t t = 1000000;
+        for (int i = 0; i < 16; i++) {
+            exchange(sync, t, 1000, 1000);
+            t += 100000;
+        }
+        CHECK(sync.request_interval() > fast);
+
+        sync.reset();
+        CHECK(sync.request_interval() == fast);
+    }
+}
+
+int main() {
+    test_converges();
+    test_rejects_asymmetric_outliers();
+    test_smooths_and_snaps();
+    test_server_tick();
+    test_request_interval();
+
+    return snow_test::check_report("time sync");
+}